@@ -1,7 +1,7 @@
 /*
  * XorgIdleManager: a utility designed to manage system sleep or shutdown based on inactivity in X11 environments.
  *
- * Version: 1.6
+ * Version: 1.7
  * 
  * Copyright (C) 2025 Maksym Nazar.
  * Created with the assistance of Perplexity, ChatGPT, and Claude.
@@ -20,76 +20,102 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
+
 #include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <fnmatch.h>
+#include <gdk/gdkx.h>
+#include <glob.h>
 #include <gtk/gtk.h>
 #include <limits.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <poll.h>
+#include <pwd.h>
+#include <regex.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
+#include <utmpx.h>
+#include <X11/Xlib.h>
+#include <X11/extensions/dpms.h>
+#include <X11/extensions/scrnsaver.h>
+#include <X11/extensions/sync.h>
 
 #define MAX_COMMAND_LENGTH 1024
 #define MAX_PATH_LENGTH 1024
 #define MAX_ERROR_LENGTH 1024
+#define MAX_LOG_SIZE (300 * 1024)
+#define LOG_BUFFER_SIZE (16 * 1024)
+#define LOG_LINE_MAX 1024
+#define LOG_ROTATE_COUNT 2
+#define SAMPLE_RING_CAPACITY 65536
+#define ACTIVITY_RING_SLOTS 4096
+#define ACTIVITY_HISTOGRAM_BUCKETS 256
+#define ACTIVITY_EVENT_QUEUE 64
+#define MAX_CPUS 512
+#define PROC_STAT_BUFFER_SIZE (64 * 1024)
+#define MAX_DISKS 256
+#define PROC_DISKSTATS_BUFFER_SIZE (64 * 1024)
+#define MAX_INTERFACES 512
+#define MAX_CGROUPS 64
+#define CGROUP_ROOT "/sys/fs/cgroup"
+#define PSI_TRIGGER_WINDOW_MS 2000
+#define ACTIVITY_CHECK_PENDING (-1)
+#define RTNETLINK_BUFFER_SIZE (32 * 1024)
+#define MAX_CONTROL_SUBSCRIBERS 8
+#define MAX_CONTROL_CLIENTS 8
+#define CONTROL_COMMAND_SIZE 256
+#define CONTROL_CLIENT_TIMEOUT_MS 1000
+#define CONTROL_STATUS_SIZE 2048
+#define MAX_TRACKED_PROCESSES 4096
+#define PROC_CONNECTOR_BUFFER_SIZE (16 * 1024)
+#define PROC_CONNECTOR_RCVBUF (1024 * 1024)
+#define MAX_APP_PATTERNS 64
+#define TASK_COMM_LENGTH 16
+#define PROCESS_CMDLINE_SIZE 4096
 
-static const char icon_base64[] =
-    "iVBORw0KGgoAAAANSUhEUgAAAEAAAABACAMAAACdt4HsAAAACXBIWXMAAA3XAAAN1wFCKJt4AAAC61BMVEVHcEwojN1/7vpDpOVc7Pxr8f6U+Poo1fc/3PdS5fkix/WW+/0etvGJ+f2T+vyV+/+R/P6T+/0gddMamucbc9Adg9yU+/0dddMddtMYlecYkuEdhuAXpemT+/2V+P0cctIYquqM+v539P1BSHonHv4lG0QnKVMlHkWO/P4oK1j+/v4cctAmH0omJ1AmHEIXzvcoHUWN+f4lGkcHmOoFn+qU/P3W4/5mMNWlmv0nIFUgFkElHE77/PwoL16rpP2onv0iHUYqKFMSyPd0+vwKvvYhGEURXcwRY88Wre2E+vx+TevQ3f3f6v6CT+sGpO3Y2eAYf9ggG0n6SowfcMsbeNGu/v5nNtpmrL4fS5FmN+AbndD39/kfUZWGUewQatEqJmgnIl0YuO74Q5NpMtvv7/OSkagyLXUVi94VouqFTPIJkelBXXv+XInsMqD8U4uena8cOXQxLVfo8f3I2v4dMGmPT/EfIVYX1fdIQmciJFmJS/EUmeLzNZlvcY3+gnud/v3i4+q8vclAO2Cwqf4tJUwOUccVwfN+Ue7JytOm/v5HLpF+PNLBufb+coBXVXcbyfGfjvRq4/QaX6Pv9/599v0fVMMhuuJOLKv+ZYY2PGp/e5ZgorVoZ4SvrruIiJ5TTGkkrdhBIXY3MlsXSZ0TbKtzOMcbQ4UeHVAgK2ATU9J/TfdBQ3clPmm1tsQoQLWXevKmlPw4MITp6u78kXpiX34QddX0z92snMtkLNo7weXD0PV0xNNZxd9WhaMgfOROT3A7IkoqRXq2xvrvWqe4qNmM7fUeYrUSZd0fL3ylK4JYS3azo9S1sPan9/d0cpWYUe0Tg8HaTnzmdnagqb59aoj34Oj0v9zBst6B3ORttcb7fZKDnLMeWoWXlebb2fiOitz5noxJL0xwOujvhL6Ed9GrMHuhm/BIbo2MKXX6xLmywNpsYLLV2evS7/iT1vOdVfprM86dlsbxqMVaKr67sNNgnNY8irySNYKdUfRzA8gWAAAAI3RSTlMAG/kJ/vv8/v3++i760G9S4ZN8mO/Cs925Z+pRy4C4o+zCrdI1TwQAAApnSURBVFjDbZd5WBNnHseD9aKuR9Xe7bb2eUjKJANDOCTJAAkQSKQSIqwKQQVJIICaRGlIjGgSI6aKQSGIIIdGRORQYal4IUXEtmrV1lu7brfa+9i22z3+3N/7ziSAT7/JHJnM5/P+3ndmkhkOZywzZr0wZ2p0dPTbTPzLiYmYs+D1GZw/yuwFwG4Z42HfcZlomTnrmafxGTOjce6dvb8Msh/eeMJZFsj9s/cY15zZE/lZqPSp979piAuNC6TB01QBafJ0NcSN2/rNslGkeG48/xzC9zeExoWyiRtqcdhpwh+tW+dhv5HB1D04Cp16Yawbz0VERN8rZffghoZadHYEGRqbPK2tnqZGnaOPIOwGC3yJAo6GszBCLwTqB/5sdyjzdWjoUA9N2HWtYZCQMCEVEhICS0uLiqB7hrhMoMRlMLKvs+M3NSLibFwcYw91NtOaZqAxJxRAhBD0qbWHppudAcWyCGUEczz/HBFxz9++rKmPaHaGhFDQsMsjFwokYHAKQoRCCgqyOIi+JrQbiQxnI5Qz8fGPjogoxTzJNRlolUcqhQYpodSjEqsFQjXp1vRZoAiKogSSfjttkLE1dI8qlbOZAu4zzZOmHqLZ5ex3gkIo0dF0n0mtlnhUR24aUCUU5Sv1wS4Ok4wZykElKiEIRqALC0iTg9DxWmpra69JBRKJqVE1JJFIjjRoW1QtEolIwiv95C+fDIoMhNuHDaa4Ua93Bmc2jCDTAeBbeIba2vW1tRVSiUjkuwYzkdncpGo2wYoUeMhDiQ5qwCVw93u9s+AcUA5yES8zEAa5DniUCqkoLw/eeR5PntVshRXEv8cYDESzDIX7jdf7FmeBUlmKeLKCcMh3VLGC9RXyvFWQLreqAehViH8PAoLRNnUP0SiTkaSs2+udyZmj9MZBl0inVuXqXbTiDMDvoDCGa25VFxKpGR4Mo+npuTKVZogEAXfPlCmcSd5JsEaSDrpVtKh4xYoqhgeDdFVhYWFXF8yAn7plyxbM69PT042tGjdUQJLnpkwGwR44Lch+ollcDzwYMB6DakAGFCnmkWE0PSo9PeqGXEdUkCTXdW4yCJL2wHhyVbRFfXjFCtYQ805MTAwy9PYW9hZC+9GMYBLwURCpq89uAgMWTNkDh6SCuPNfwY7tWLC4CuEo17BBXap8G/1YbdkyKSoKG9rk8kaiEQuCOVNAIJO5iZG13wqRYTGkihXENMoLe4FXol/I6Og9kZFRSNEGlxaU4AJBMCPgWog7a9eu/Va+YzGTMYNaVOpVKpGC5aPSES9U64h+GEQkmAyDqCMeg2Dtx8IxQxpKTMzDQa83CRuAj2R5uEglTrqZJE9Pn86ZPDmYhAtuLc7Hkh2LIGC4yhrSkpKSlMgQ4KVCCYrIrZVhQXDwdNJH39m0aRNbw/Zxhpi0DYj3sjwYgBcdgUhELcQQeYAV9BOPQbBpZATXgA2LFl9FFWzY4E1KgjfikaBGLBSJuKFgMHuIFvLAtOmc6dNPky3EyGoQ3EF1sAbIVcCxICkpOLIEdwDzMqfW0XDEHKppBsE0JBA0E6tXrx55fPv24xHGsB07rvoFwSUlJaiENnEIusJFTUSfxWxWqQSsQOrWgOAO+gO4AytfIQPwx09cYATByekgKIlskwsRb7Va3YTKanVoAwLV7SVLVi9Zd/LkyGqUr+TIcDw29kQVEgQnJyeml+D24ecFcK7VQRD91pu0CQumnZbaT65bAvnttyVIBAY4FsDHngAD4sGgiMT991nMVrM5TksQOrOOduaET+NMm7ZX2ndy3Tqs8Odb9Q+xsYwB85Ab4pC8PGuTvcJqbnAQ9HoQEJYJgrEs+ZTqupqADbHH9ayg/HOxKM/alfZIA81r0tIqrFgQznkWBPaTa8aybt2nHzTEb90KdELC7lNH9YnJyfnJ5eVgMHd0fH/mQtqjMxcunInrMBDOnGpGoLq9b82afWse7NsHyzXAf711KzIk7F546uhRfWVlcnh5OBjkeWVdPwINfGlHBwxiTnU159nqvVKHBtB9D07u2gWLTz/wfR0PFWyNjz2+FAQpKfpKaD88PLx8WNxR1tUDJ+j3pR1lZQ6NAAvK90oN9INdEDQD3vS3eCzYuvtUQUHB0dTUVAXCQVDeLS6DDA+jufFHFQ8LwvdKG+kvgN28efOuXZ8xPFJ8vfBUdkH2hx9+eHSbItxvkJcZy4zG0uEy47Cmh5dTWYm7MER/t5nJGB+/e+HChae+BME2iIIVVCMDsCqjcZBu4eXkY4HApb09nk9g+V+QAdpnDYlIUd2tNra333xobL9JtwYEgh76i79CPvuH7O8J8QkJCUz7kIJ/YTxl21FUQyI4kGF5e3v7crudB4J8zp8qQdBEf+fnE5AhfvdSlpdIDqUwQTVAwqvL1Mtzl+cO0oZxAlmfFkpg+ASWhyNQUC85WKg+lJqKBFBDot+QW1PzPdHKo7Ag/wDcxejo775AfCy84PxD7SNeeHDnsVXyQyuxIlWBBYnVezuOtP1H4w4BgcIv8Gk1t8ToAkICzC9l+J3Hjq0STzRUVueIu88Q/VigYAWCFrpF+iSWOf8xv3Rpvfrg4Z07654yVCZWVubLW2k3jxcQ8HgwCna76YfYE2AI8ELE/+88awBFaupKZKisvBHmplulYwIpMjRpDJInJ2Jx+0sD/PV/ns8Aw0fIgBQr84HPIW+hQ8DjCZHgzXyFgIcMhh/7RU8SdmcXAJ2dXR9y8PDhndeR4P26Y3UfyZEBHGA4wLXcVblQD6Q2vZ7zmiK/AwtMv/9uET3JzkZ4Nmr/8M53r19/93xGVkZdXR1TA0pOh+/KXScgYVSoXv8mZ55C8TniBZTzyhWLpD4bpV6OeZTzGRDG8D5k5SW1b+BiKw9nWG97jfOyXnEDcOSwgEFdz/C//IL5jRvPFyFDit9QI/QN3L1MUYin2my2eZwgvV5vFTAbnAMXL4sP7ugVsvzGjUiAk1qX8pHYeMgotsA+YWG4ALLIZnuVw3lNr69hBDzK9+vFRpdY3ruw4EsG31hcwqSIn5LSLhZTty4OOFmeWm6zvQIPHS/bbLYOpk88ytV4ceDyjuxTXwJeXIwF6G8xEgwZqSntlwcu6kyUv4CsoqJ5cLP9zCs22w0Ba+AJLw/cvXu8s7OzuLh4MUyd+K4kChS2on//emXAQ6H7ftxYTUbRK0Hofv9Vm62oBhtC0Mx1za7RVrGO4k50XwjRn/55vUZ1yxWGA7f+VDuM7VzmkWUeDFKu1F8DRcF9Ok1rq04cX1Hc2alXKPJPn/v5J42mT+ekwvwCwTA/K+N59pnpmefBUCPhjSkojwEcYHn0aMNP6zUQe3O/iwqjAnwun5/1YhAnYIByMo0BQxgPjoqvSdej0mo0WpXDcMviRxnceInP54/xYHgpIyMr61J7h4DHnCNMHRCXgHnaodB2Cm0UxLVfyszk818KmvDo+vL8LJTMSzW5OMufDrM5twbgTH5m5vy5Tz88B72BBfDK4mfx0RuFXUAy8ZSJw58/N+gPHt+D5r40P0Bl8icGPmcybWe++Mar457d/w+H3IXxpooBiQAAAABJRU5ErkJggg==";
+/*
+ * The icon, LICENSE.txt and TERMS_OF_USE.txt are compiled into the binary as a GResource
+ * (XorgIdleManager.gresource.xml) and only looked up when they are shown.
+ */
+#define RESOURCE_PATH "/org/xorgidlemanager/"
 
 static void set_window_icon(GtkWidget *window) {
-    g_print("Attempting to set window icon...\n");
-    GdkPixbuf *icon = NULL;
     GError *error = NULL;
-    gsize data_len;
-
-    guchar* data = g_base64_decode(icon_base64, &data_len);
-    if (!data) {
-        g_warning("Failed to decode Base64 data\n");
-        return;
-    }
-
-    GInputStream *stream = g_memory_input_stream_new_from_data(data, data_len, g_free);
-    if (!stream) {
-        g_warning("Failed to create input stream\n");
-        g_free(data);
-        return;
-    }
-    g_print("Input stream created successfully\n");
-
-    icon = gdk_pixbuf_new_from_stream(stream, NULL, &error);
-    g_object_unref(stream);
-
-    if (error) {
+    GdkPixbuf *icon = gdk_pixbuf_new_from_resource(RESOURCE_PATH "XorgIdleManager.png", &error);
+    if (icon == NULL) {
         g_warning("Error loading icon: %s", error->message);
         g_error_free(error);
         return;
     }
-
-    if (icon) {
-        int width = gdk_pixbuf_get_width(icon);
-        int height = gdk_pixbuf_get_height(icon);
-        g_print("Original icon size: %dx%d\n", width, height);
-
-        GdkPixbuf *scaled_icon = gdk_pixbuf_scale_simple(icon, 
-            width,
-            height,
-            GDK_INTERP_BILINEAR);
-
-        if (scaled_icon) {
-            gtk_window_set_icon(GTK_WINDOW(window), scaled_icon);
-            g_object_unref(scaled_icon);
-            g_print("Icon set successfully at %dx%d\n", width, height);
-        } else {
-            g_warning("Failed to process icon\n");
-        }
-        g_object_unref(icon);
-    } else {
-        g_warning("Failed to create icon from data\n");
-    }
+    gtk_window_set_icon(GTK_WINDOW(window), icon);
+    g_object_unref(icon);
 }
 
 const int DEFAULT_INACTIVITY_TIMEOUT_SLEEP = 3600000;
@@ -107,10 +133,50 @@ const int DEFAULT_IO_CHECK_INTERVAL = 1;
 const int DEFAULT_BOOT_GRACE_PERIOD = 20;
 const int DEFAULT_ACTION_TYPE_SLEEP = 0;
 const int DEFAULT_ACTION_TYPE_SHUTDOWN = 1;
+const int CPU_POLICY_AGGREGATE = 0;
+const int CPU_POLICY_ANY_CORE = 1;
+const int CPU_POLICY_TOP_CORES = 2;
+const int DEFAULT_CPU_POLICY = 0;
+const int LOG_LEVEL_ERROR = 0;
+const int LOG_LEVEL_WARNING = 1;
+const int LOG_LEVEL_INFO = 2;
+const int LOG_LEVEL_DEBUG = 3;
+const int DEFAULT_LOG_LEVEL = 2;
+const int DEFAULT_CPU_TOP_CORES = 2;
+const int ACTIVITY_STATISTIC_AVERAGE = 0;
+const int ACTIVITY_STATISTIC_MAX = 1;
+const int ACTIVITY_STATISTIC_P95 = 2;
+const int DEFAULT_ACTIVITY_WINDOW = 30;
+const int DEFAULT_SAMPLE_INTERVAL = 2;
+const int DEFAULT_ACTIVITY_STATISTIC = 0;
+const int DEFAULT_ACTIVITY_BUSY_PERCENT = 0;
+const int DEFAULT_CPU_EXIT_THRESHOLD = 40;
+const int DEFAULT_IO_EXIT_THRESHOLD = 4000;
+const int DEFAULT_NET_EXIT_THRESHOLD = 200;
+const int DEFAULT_EWMA_WEIGHT = 50;
+const int DEFAULT_MIN_DWELL_TIME = 10;
+const int DEFAULT_CGROUP_CPU_THRESHOLD = 20;
+const int DEFAULT_CGROUP_IO_THRESHOLD = 2000;
+const int ACTIVITY_SOURCE_COUNTERS = 0;
+const int ACTIVITY_SOURCE_PSI = 1;
+const int DEFAULT_ACTIVITY_SOURCE = 0;
+const int DEFAULT_PSI_CPU_THRESHOLD = 20;
+const int DEFAULT_PSI_IO_THRESHOLD = 10;
+const int DEFAULT_PSI_AVERAGE = 10;
+const int DEFAULT_PSI_TRIGGER_MS = 0;
 const char *DEFAULT_CUSTOM_LONG_RUNNING_APPS = "smplayer|mplayer|vlc";
 const char *DEFAULT_SLEEP_COMMAND = "sync; pm-suspend";
 const char *DEFAULT_SHUTDOWN_COMMAND = "sync; shutdown -h now";
 const char *DEFAULT_CUSTOM_NO_GUI_COMMAND = "sync; shutdown -h now";
+const char *DEFAULT_IO_DEVICES_INCLUDE = "";
+const char *DEFAULT_IO_DEVICES_EXCLUDE = "loop*|ram*|zram*|dm-*|md*";
+const char *DEFAULT_NET_INTERFACES_INCLUDE = "";
+const char *DEFAULT_NET_INTERFACES_EXCLUDE = "lo";
+const char *DEFAULT_NET_KINDS_EXCLUDE = "*";
+const char *DEFAULT_ACTIVITY_DENYLIST = "updatedb*|plocate*|baloo_file*|tracker-miner-f*|tracker-extract*|packagekitd|apt-check|mandb";
+const char *DEFAULT_ACTIVITY_ALLOWLIST = "";
+const char *DEFAULT_CGROUPS_INCLUDE = "";
+const char *DEFAULT_CGROUPS_EXCLUDE = "";
 
 int inactivity_timeout = DEFAULT_INACTIVITY_TIMEOUT_SLEEP;
 int long_running_apps_timeout = DEFAULT_LONG_RUNNING_APPS_TIMEOUT_SLEEP;
@@ -122,14 +188,43 @@ int cpu_net_check_interval = DEFAULT_CPU_NET_CHECK_INTERVAL;
 int io_check_interval = DEFAULT_IO_CHECK_INTERVAL;
 int boot_grace_period = DEFAULT_BOOT_GRACE_PERIOD;
 int action_type = DEFAULT_ACTION_TYPE_SLEEP;
+int cpu_policy = DEFAULT_CPU_POLICY;
+int log_level = DEFAULT_LOG_LEVEL;
+int activity_window = DEFAULT_ACTIVITY_WINDOW;
+int sample_interval = DEFAULT_SAMPLE_INTERVAL;
+int activity_statistic = DEFAULT_ACTIVITY_STATISTIC;
+int activity_busy_percent = DEFAULT_ACTIVITY_BUSY_PERCENT;
+int cpu_exit_threshold = DEFAULT_CPU_EXIT_THRESHOLD;
+int io_exit_threshold = DEFAULT_IO_EXIT_THRESHOLD;
+int net_exit_threshold = DEFAULT_NET_EXIT_THRESHOLD;
+int ewma_weight = DEFAULT_EWMA_WEIGHT;
+int min_dwell_time = DEFAULT_MIN_DWELL_TIME;
+int cgroup_cpu_threshold = DEFAULT_CGROUP_CPU_THRESHOLD;
+int cgroup_io_threshold = DEFAULT_CGROUP_IO_THRESHOLD;
+int activity_source = DEFAULT_ACTIVITY_SOURCE;
+int psi_cpu_threshold = DEFAULT_PSI_CPU_THRESHOLD;
+int psi_io_threshold = DEFAULT_PSI_IO_THRESHOLD;
+int psi_average = DEFAULT_PSI_AVERAGE;
+int psi_trigger_ms = DEFAULT_PSI_TRIGGER_MS;
+int cpu_top_cores = DEFAULT_CPU_TOP_CORES;
 char custom_long_running_apps[MAX_COMMAND_LENGTH];
 char sleep_command[MAX_COMMAND_LENGTH];
 char shutdown_command[MAX_COMMAND_LENGTH];
 char custom_no_gui_command[MAX_COMMAND_LENGTH];
+char io_devices_include[MAX_COMMAND_LENGTH];
+char io_devices_exclude[MAX_COMMAND_LENGTH];
+char net_interfaces_include[MAX_COMMAND_LENGTH];
+char net_interfaces_exclude[MAX_COMMAND_LENGTH];
+char net_kinds_exclude[MAX_COMMAND_LENGTH];
+char activity_denylist[MAX_COMMAND_LENGTH];
+char activity_allowlist[MAX_COMMAND_LENGTH];
+char cgroups_include[MAX_COMMAND_LENGTH];
+char cgroups_exclude[MAX_COMMAND_LENGTH];
 int dpms_enabled = 1;
 int dpms_standby = 600;
 int dpms_suspend = 600;
 int dpms_off = 600;
+int daemon_mode = 0;
 
 GtkWidget *inactivity_timeout_entry;
 GtkWidget *long_running_apps_timeout_entry;
@@ -138,6 +233,11 @@ GtkWidget *check_interval_entry;
 GtkWidget *cpu_threshold_entry;
 GtkWidget *io_threshold_entry;
 GtkWidget *net_threshold_entry;
+GtkWidget *cpu_exit_threshold_entry;
+GtkWidget *io_exit_threshold_entry;
+GtkWidget *net_exit_threshold_entry;
+GtkWidget *ewma_weight_entry;
+GtkWidget *min_dwell_time_entry;
 GtkWidget *cpu_net_check_interval_entry;
 GtkWidget *io_check_interval_entry;
 GtkWidget *boot_grace_period_entry;
@@ -149,10 +249,24 @@ GtkWidget *dpms_enabled_check;
 GtkWidget *dpms_standby_entry;
 GtkWidget *dpms_suspend_entry;
 GtkWidget *dpms_off_entry;
+GtkWidget *status_daemon_label;
+GtkWidget *status_idle_label;
+GtkWidget *status_timeout_label;
+GtkWidget *status_app_label;
+GtkWidget *status_rates_label;
+GtkWidget *status_action_label;
 
-gboolean restart_daemon_async(gpointer user_data);
+GtkWidget *save_button;
+GtkWidget *apply_progress_label;
+
+void start_apply_job(void);
 
 void show_error(const char *message) {
+    if (daemon_mode) {
+        fprintf(stderr, "%s\n", message);
+        return;
+    }
+
     GtkWidget *dialog = gtk_message_dialog_new(NULL,
                                                GTK_DIALOG_MODAL,
                                                GTK_MESSAGE_ERROR,
@@ -183,6 +297,30 @@ int validate_integer_input(const char *input, int min, int max) {
     return (value >= min && value <= max);
 }
 
+int validate_script_command(const char *command) {
+    if (!command || strlen(command) < 1) return 0;
+
+    char *copy = strdup(command);
+    if (!copy) return 0;
+
+    int valid = 1;
+    char *token = strtok(copy, ";");
+    while (token && valid) {
+        char *trimmed = token;
+        while (*trimmed == ' ') trimmed++;
+
+        if (strlen(trimmed) > 0) {
+            if (strchr(trimmed, '|') || strchr(trimmed, '>') || strchr(trimmed, '<')) {
+                valid = 0;
+            }
+        }
+        token = strtok(NULL, ";");
+    }
+
+    free(copy);
+    return valid;
+}
+
 void ensure_config_dir_exists(void) {
     char config_dir[MAX_PATH_LENGTH];
     snprintf(config_dir, sizeof(config_dir), "%s/.XorgIdleManager", getenv("HOME"));
@@ -197,91 +335,156 @@ void ensure_config_dir_exists(void) {
     }
 }
 
-void execute_command(const char* command, char* const argv[]) {
-    pid_t pid = fork();
-    if (pid == -1) {
-        show_error("Failed to fork process.");
-        return;
+/* The X display behind the settings window, or NULL when GTK is not running on X11. */
+static Display *window_xdisplay(void) {
+    GdkDisplay *display = gdk_display_get_default();
+    if (display == NULL || !GDK_IS_X11_DISPLAY(display)) {
+        return NULL;
     }
+    return GDK_DISPLAY_XDISPLAY(display);
+}
 
-    if (pid == 0) {
-        execvp(command, argv);
-        _exit(EXIT_FAILURE);
-    } else {
-        waitpid(pid, NULL, 0);
-    }
+static int window_has_dpms(Display *display) {
+    int event_base, error_base;
+    return display != NULL && DPMSQueryExtension(display, &event_base, &error_base) && DPMSCapable(display);
 }
 
+/* Loads the current DPMS state of the X server into the dpms_* settings. */
 void get_dpms_settings() {
-    pid_t pid = fork();
-    if (pid == -1) {
-        show_error("Failed to fork process for DPMS settings.");
+    Display *display = window_xdisplay();
+    if (!window_has_dpms(display)) {
         return;
     }
 
-    if (pid == 0) {
-        int pipe_fd[2];
-        if (pipe(pipe_fd) == -1) {
-            _exit(EXIT_FAILURE);
-        }
-
-        pid_t child_pid = fork();
-        if (child_pid == -1) {
-            _exit(EXIT_FAILURE);
-        }
-
-        if (child_pid == 0) { 
-            close(pipe_fd[0]);
-            dup2(pipe_fd[1], STDOUT_FILENO);
-            execlp("xset", "xset", "q", NULL);
-            _exit(EXIT_FAILURE); 
-        } 
-        
-        close(pipe_fd[1]);
-        FILE* stream_fp = fdopen(pipe_fd[0], "r");
-        if (stream_fp == NULL) {
-            _exit(EXIT_FAILURE);
-        }
-
-        char line[256];
-        while (fgets(line, sizeof(line), stream_fp) != NULL) {
-            if (strstr(line, "DPMS is Enabled")) {
-                dpms_enabled = 1;
-            } else if (strstr(line, "DPMS is Disabled")) {
-                dpms_enabled = 0;
-            } else if (strstr(line, "Standby:")) {
-                sscanf(line, " Standby: %d Suspend: %d Off: %d", 
-                       &dpms_standby, &dpms_suspend, &dpms_off);
-            }
-        }
+    CARD16 power_level;
+    BOOL enabled;
+    if (DPMSInfo(display, &power_level, &enabled)) {
+        dpms_enabled = enabled ? 1 : 0;
+    }
 
-        fclose(stream_fp);
-        waitpid(child_pid, NULL, 0);
-        _exit(EXIT_SUCCESS);
-    } 
-    
-    int status;
-    waitpid(pid, &status, 0);
+    CARD16 standby, suspend, off;
+    if (DPMSGetTimeouts(display, &standby, &suspend, &off)) {
+        dpms_standby = standby;
+        dpms_suspend = suspend;
+        dpms_off = off;
+    }
+}
+
+/* X rejects DPMS timeouts whose non-zero values decrease from standby to suspend to off. */
+int dpms_timeouts_ordered(int standby, int suspend, int off) {
+    return !((standby && suspend && standby > suspend) ||
+             (standby && off && standby > off) ||
+             (suspend && off && suspend > off));
+}
+
+/*
+ * Applies DPMS settings on the given connection and reads them back; returns 0 with a message
+ * when the server lacks DPMS or did not take them.
+ */
+int apply_dpms_settings(Display *display, int enabled, int standby, int suspend, int off, char *error, size_t error_size) {
+    if (!window_has_dpms(display)) {
+        snprintf(error, error_size, "The X server does not support DPMS.");
+        return 0;
+    }
+
+    if (enabled) {
+        DPMSEnable(display);
+        DPMSSetTimeouts(display, standby, suspend, off);
+    } else {
+        DPMSDisable(display);
+    }
+
+    CARD16 power_level, current_standby, current_suspend, current_off;
+    BOOL current_enabled;
+    if (!DPMSInfo(display, &power_level, &current_enabled) || !current_enabled != !enabled ||
+        (enabled && (!DPMSGetTimeouts(display, &current_standby, &current_suspend, &current_off) ||
+                     current_standby != standby || current_suspend != suspend || current_off != off))) {
+        snprintf(error, error_size, "The X server did not accept the DPMS settings.");
+        return 0;
+    }
+    return 1;
+}
+
+static void copy_quoted_value(char *dest, size_t size, const char *value) {
+    size_t len = strlen(value);
+    if (len >= 2 && value[0] == '\'' && value[len - 1] == '\'') {
+        value++;
+        len -= 2;
+    }
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(dest, value, len);
+    dest[len] = '\0';
+}
+
+/* Keys missing from config.ini fall back to these, so a key removed before a reload does not keep its old value. */
+static void reset_config_defaults(void) {
+    inactivity_timeout = DEFAULT_INACTIVITY_TIMEOUT_SLEEP;
+    long_running_apps_timeout = DEFAULT_LONG_RUNNING_APPS_TIMEOUT_SLEEP;
+    check_interval = DEFAULT_CHECK_INTERVAL;
+    cpu_threshold = DEFAULT_CPU_THRESHOLD;
+    io_threshold = DEFAULT_IO_THRESHOLD;
+    net_threshold = DEFAULT_NET_THRESHOLD;
+    cpu_net_check_interval = DEFAULT_CPU_NET_CHECK_INTERVAL;
+    io_check_interval = DEFAULT_IO_CHECK_INTERVAL;
+    boot_grace_period = DEFAULT_BOOT_GRACE_PERIOD;
+    action_type = DEFAULT_ACTION_TYPE_SLEEP;
+    cpu_policy = DEFAULT_CPU_POLICY;
+    log_level = DEFAULT_LOG_LEVEL;
+    activity_window = DEFAULT_ACTIVITY_WINDOW;
+    sample_interval = DEFAULT_SAMPLE_INTERVAL;
+    activity_statistic = DEFAULT_ACTIVITY_STATISTIC;
+    activity_busy_percent = DEFAULT_ACTIVITY_BUSY_PERCENT;
+    cpu_exit_threshold = DEFAULT_CPU_EXIT_THRESHOLD;
+    io_exit_threshold = DEFAULT_IO_EXIT_THRESHOLD;
+    net_exit_threshold = DEFAULT_NET_EXIT_THRESHOLD;
+    ewma_weight = DEFAULT_EWMA_WEIGHT;
+    min_dwell_time = DEFAULT_MIN_DWELL_TIME;
+    cgroup_cpu_threshold = DEFAULT_CGROUP_CPU_THRESHOLD;
+    cgroup_io_threshold = DEFAULT_CGROUP_IO_THRESHOLD;
+    activity_source = DEFAULT_ACTIVITY_SOURCE;
+    psi_cpu_threshold = DEFAULT_PSI_CPU_THRESHOLD;
+    psi_io_threshold = DEFAULT_PSI_IO_THRESHOLD;
+    psi_average = DEFAULT_PSI_AVERAGE;
+    psi_trigger_ms = DEFAULT_PSI_TRIGGER_MS;
+    cpu_top_cores = DEFAULT_CPU_TOP_CORES;
+
+    copy_quoted_value(custom_long_running_apps, sizeof(custom_long_running_apps), DEFAULT_CUSTOM_LONG_RUNNING_APPS);
+    copy_quoted_value(sleep_command, sizeof(sleep_command), DEFAULT_SLEEP_COMMAND);
+    copy_quoted_value(shutdown_command, sizeof(shutdown_command), DEFAULT_SHUTDOWN_COMMAND);
+    copy_quoted_value(custom_no_gui_command, sizeof(custom_no_gui_command), DEFAULT_CUSTOM_NO_GUI_COMMAND);
+    copy_quoted_value(io_devices_include, sizeof(io_devices_include), DEFAULT_IO_DEVICES_INCLUDE);
+    copy_quoted_value(io_devices_exclude, sizeof(io_devices_exclude), DEFAULT_IO_DEVICES_EXCLUDE);
+    copy_quoted_value(net_interfaces_include, sizeof(net_interfaces_include), DEFAULT_NET_INTERFACES_INCLUDE);
+    copy_quoted_value(net_interfaces_exclude, sizeof(net_interfaces_exclude), DEFAULT_NET_INTERFACES_EXCLUDE);
+    copy_quoted_value(net_kinds_exclude, sizeof(net_kinds_exclude), DEFAULT_NET_KINDS_EXCLUDE);
+    copy_quoted_value(activity_denylist, sizeof(activity_denylist), DEFAULT_ACTIVITY_DENYLIST);
+    copy_quoted_value(activity_allowlist, sizeof(activity_allowlist), DEFAULT_ACTIVITY_ALLOWLIST);
+    copy_quoted_value(cgroups_include, sizeof(cgroups_include), DEFAULT_CGROUPS_INCLUDE);
+    copy_quoted_value(cgroups_exclude, sizeof(cgroups_exclude), DEFAULT_CGROUPS_EXCLUDE);
 }
 
 void read_config(void) {
     ensure_config_dir_exists();
+    reset_config_defaults();
     
     char config_path[MAX_PATH_LENGTH];
     snprintf(config_path, sizeof(config_path), "%s/.XorgIdleManager/config.ini", getenv("HOME"));
     FILE *fp = fopen(config_path, "r");
     if (fp == NULL) {
-        strncpy(custom_long_running_apps, DEFAULT_CUSTOM_LONG_RUNNING_APPS, sizeof(custom_long_running_apps) - 1);
-        strncpy(sleep_command, DEFAULT_SLEEP_COMMAND, sizeof(sleep_command) - 1);
-        strncpy(shutdown_command, DEFAULT_SHUTDOWN_COMMAND, sizeof(shutdown_command) - 1);
-        strncpy(custom_no_gui_command, DEFAULT_CUSTOM_NO_GUI_COMMAND, sizeof(custom_no_gui_command) - 1);
         return;
     }
     
     char line[MAX_COMMAND_LENGTH * 2];
     while (fgets(line, sizeof(line), fp) != NULL) {
         char key[64], value[MAX_COMMAND_LENGTH * 2];
-        if (sscanf(line, "%63[^=]=%[^\n]", key, value) == 2) {
+        int fields = sscanf(line, "%63[^=]=%[^\n]", key, value);
+        if (fields == 1 && strchr(line, '=') != NULL) {
+            value[0] = '\0';
+            fields = 2;
+        }
+        if (fields == 2) {
             if (strcmp(key, "inactivity_timeout") == 0) {
                 inactivity_timeout = atoi(value);
             } else if (strcmp(key, "long_running_apps_timeout") == 0) {
@@ -296,6 +499,30 @@ void read_config(void) {
                 io_threshold = atoi(value);
             } else if (strcmp(key, "net_threshold") == 0) {
                 net_threshold = atoi(value);
+            } else if (strcmp(key, "cpu_exit_threshold") == 0) {
+                cpu_exit_threshold = atoi(value);
+            } else if (strcmp(key, "io_exit_threshold") == 0) {
+                io_exit_threshold = atoi(value);
+            } else if (strcmp(key, "net_exit_threshold") == 0) {
+                net_exit_threshold = atoi(value);
+            } else if (strcmp(key, "ewma_weight") == 0) {
+                ewma_weight = atoi(value);
+            } else if (strcmp(key, "cgroup_cpu_threshold") == 0) {
+                cgroup_cpu_threshold = atoi(value);
+            } else if (strcmp(key, "cgroup_io_threshold") == 0) {
+                cgroup_io_threshold = atoi(value);
+            } else if (strcmp(key, "activity_source") == 0) {
+                activity_source = atoi(value);
+            } else if (strcmp(key, "psi_cpu_threshold") == 0) {
+                psi_cpu_threshold = atoi(value);
+            } else if (strcmp(key, "psi_io_threshold") == 0) {
+                psi_io_threshold = atoi(value);
+            } else if (strcmp(key, "psi_average") == 0) {
+                psi_average = atoi(value);
+            } else if (strcmp(key, "psi_trigger_ms") == 0) {
+                psi_trigger_ms = atoi(value);
+            } else if (strcmp(key, "min_dwell_time") == 0) {
+                min_dwell_time = atoi(value);
             } else if (strcmp(key, "cpu_net_check_interval") == 0) {
                 cpu_net_check_interval = atoi(value);
             } else if (strcmp(key, "io_check_interval") == 0) {
@@ -304,15 +531,44 @@ void read_config(void) {
                 boot_grace_period = atoi(value);
             } else if (strcmp(key, "action_type") == 0) {
                 action_type = atoi(value);
+            } else if (strcmp(key, "cpu_policy") == 0) {
+                cpu_policy = atoi(value);
+            } else if (strcmp(key, "log_level") == 0) {
+                log_level = atoi(value);
+            } else if (strcmp(key, "activity_window") == 0) {
+                activity_window = atoi(value);
+            } else if (strcmp(key, "sample_interval") == 0) {
+                sample_interval = atoi(value);
+            } else if (strcmp(key, "activity_statistic") == 0) {
+                activity_statistic = atoi(value);
+            } else if (strcmp(key, "activity_busy_percent") == 0) {
+                activity_busy_percent = atoi(value);
+            } else if (strcmp(key, "cpu_top_cores") == 0) {
+                cpu_top_cores = atoi(value);
+            } else if (strcmp(key, "io_devices_include") == 0) {
+                copy_quoted_value(io_devices_include, sizeof(io_devices_include), value);
+            } else if (strcmp(key, "io_devices_exclude") == 0) {
+                copy_quoted_value(io_devices_exclude, sizeof(io_devices_exclude), value);
+            } else if (strcmp(key, "net_interfaces_include") == 0) {
+                copy_quoted_value(net_interfaces_include, sizeof(net_interfaces_include), value);
+            } else if (strcmp(key, "net_interfaces_exclude") == 0) {
+                copy_quoted_value(net_interfaces_exclude, sizeof(net_interfaces_exclude), value);
+            } else if (strcmp(key, "net_kinds_exclude") == 0) {
+                copy_quoted_value(net_kinds_exclude, sizeof(net_kinds_exclude), value);
+            } else if (strcmp(key, "activity_denylist") == 0) {
+                copy_quoted_value(activity_denylist, sizeof(activity_denylist), value);
+            } else if (strcmp(key, "activity_allowlist") == 0) {
+                copy_quoted_value(activity_allowlist, sizeof(activity_allowlist), value);
+            } else if (strcmp(key, "cgroups_include") == 0) {
+                copy_quoted_value(cgroups_include, sizeof(cgroups_include), value);
+            } else if (strcmp(key, "cgroups_exclude") == 0) {
+                copy_quoted_value(cgroups_exclude, sizeof(cgroups_exclude), value);
             } else if (strcmp(key, "sleep_command") == 0) {
-                strncpy(sleep_command, value + 1, sizeof(sleep_command) - 1);
-                sleep_command[strlen(sleep_command) - 1] = '\0';
+                copy_quoted_value(sleep_command, sizeof(sleep_command), value);
             } else if (strcmp(key, "shutdown_command") == 0) {
-                strncpy(shutdown_command, value + 1, sizeof(shutdown_command) - 1);
-                shutdown_command[strlen(shutdown_command) - 1] = '\0';
+                copy_quoted_value(shutdown_command, sizeof(shutdown_command), value);
             } else if (strcmp(key, "custom_no_gui_command") == 0) {
-                strncpy(custom_no_gui_command, value + 1, sizeof(custom_no_gui_command) - 1);
-                custom_no_gui_command[strlen(custom_no_gui_command) - 1] = '\0';
+                copy_quoted_value(custom_no_gui_command, sizeof(custom_no_gui_command), value);
             }
         }
     }
@@ -341,19 +597,7 @@ void read_config(void) {
     custom_no_gui_command[sizeof(custom_no_gui_command) - 1] = '\0';
 }
 
-void save_config(void) {
-    ensure_config_dir_exists();
-    
-    char config_path[MAX_PATH_LENGTH];
-    snprintf(config_path, sizeof(config_path), "%s/.XorgIdleManager/config.ini", getenv("HOME"));
-    FILE *fp = fopen(config_path, "w");
-    if (fp == NULL) {
-        char error_message[MAX_ERROR_LENGTH];
-        snprintf(error_message, sizeof(error_message), "Failed to open config file for writing: %s", strerror(errno));
-        show_error(error_message);
-        return;
-    }
-
+static void write_config(FILE *fp) {
     fprintf(fp, "HOME=%s\n", getenv("HOME"));
     fprintf(fp, "inactivity_timeout=%d\n", inactivity_timeout);
     fprintf(fp, "long_running_apps_timeout=%d\n", long_running_apps_timeout);
@@ -362,15 +606,102 @@ void save_config(void) {
     fprintf(fp, "cpu_threshold=%d\n", cpu_threshold);
     fprintf(fp, "io_threshold=%d\n", io_threshold);
     fprintf(fp, "net_threshold=%d\n", net_threshold);
+    fprintf(fp, "cpu_exit_threshold=%d\n", cpu_exit_threshold);
+    fprintf(fp, "io_exit_threshold=%d\n", io_exit_threshold);
+    fprintf(fp, "net_exit_threshold=%d\n", net_exit_threshold);
+    fprintf(fp, "ewma_weight=%d\n", ewma_weight);
+    fprintf(fp, "min_dwell_time=%d\n", min_dwell_time);
     fprintf(fp, "cpu_net_check_interval=%d\n", cpu_net_check_interval);
     fprintf(fp, "io_check_interval=%d\n", io_check_interval);
     fprintf(fp, "boot_grace_period=%d\n", boot_grace_period);
     fprintf(fp, "action_type=%d\n", action_type);
+    fprintf(fp, "cpu_policy=%d\n", cpu_policy);
+    fprintf(fp, "log_level=%d\n", log_level);
+    fprintf(fp, "activity_window=%d\n", activity_window);
+    fprintf(fp, "sample_interval=%d\n", sample_interval);
+    fprintf(fp, "activity_statistic=%d\n", activity_statistic);
+    fprintf(fp, "activity_busy_percent=%d\n", activity_busy_percent);
+    fprintf(fp, "cpu_top_cores=%d\n", cpu_top_cores);
+    fprintf(fp, "io_devices_include=%s\n", io_devices_include);
+    fprintf(fp, "io_devices_exclude=%s\n", io_devices_exclude);
+    fprintf(fp, "net_interfaces_include=%s\n", net_interfaces_include);
+    fprintf(fp, "net_interfaces_exclude=%s\n", net_interfaces_exclude);
+    fprintf(fp, "net_kinds_exclude=%s\n", net_kinds_exclude);
+    fprintf(fp, "activity_denylist=%s\n", activity_denylist);
+    fprintf(fp, "activity_allowlist=%s\n", activity_allowlist);
+    fprintf(fp, "cgroups_include=%s\n", cgroups_include);
+    fprintf(fp, "cgroups_exclude=%s\n", cgroups_exclude);
+    fprintf(fp, "cgroup_cpu_threshold=%d\n", cgroup_cpu_threshold);
+    fprintf(fp, "cgroup_io_threshold=%d\n", cgroup_io_threshold);
+    fprintf(fp, "activity_source=%d\n", activity_source);
+    fprintf(fp, "psi_cpu_threshold=%d\n", psi_cpu_threshold);
+    fprintf(fp, "psi_io_threshold=%d\n", psi_io_threshold);
+    fprintf(fp, "psi_average=%d\n", psi_average);
+    fprintf(fp, "psi_trigger_ms=%d\n", psi_trigger_ms);
     fprintf(fp, "sleep_command='%s'\n", sleep_command);
     fprintf(fp, "shutdown_command='%s'\n", shutdown_command);
     fprintf(fp, "custom_no_gui_command='%s'\n", custom_no_gui_command);
+}
 
+/* Renders config.ini from the current settings into a malloc()ed string. */
+char *format_config(size_t *length) {
+    char *text = NULL;
+    FILE *fp = open_memstream(&text, length);
+    if (fp == NULL) {
+        return NULL;
+    }
+    write_config(fp);
     fclose(fp);
+    return text;
+}
+
+/*
+ * Writes config.ini through a temporary file, fsync() and rename(), so the daemon (and a crash
+ * halfway through) never sees a partial file. Safe to call off the GTK thread.
+ */
+int write_config_file(const char *text, size_t length, char *error, size_t error_size) {
+    char config_dir[MAX_PATH_LENGTH];
+    char config_path[MAX_PATH_LENGTH + 16];
+    char temp_path[MAX_PATH_LENGTH + 16];
+    snprintf(config_dir, sizeof(config_dir), "%s/.XorgIdleManager", getenv("HOME"));
+    snprintf(config_path, sizeof(config_path), "%s/config.ini", config_dir);
+    snprintf(temp_path, sizeof(temp_path), "%s/config.ini.tmp", config_dir);
+
+    if (mkdir(config_dir, 0755) == -1 && errno != EEXIST) {
+        snprintf(error, error_size, "Failed to create config directory: %s", strerror(errno));
+        return 0;
+    }
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        snprintf(error, error_size, "Failed to open config file for writing: %s", strerror(errno));
+        return 0;
+    }
+    size_t written = 0;
+    while (written < length) {
+        ssize_t len = write(fd, text + written, length - written);
+        if (len == -1 && errno == EINTR) {
+            continue;
+        }
+        if (len == -1) {
+            snprintf(error, error_size, "Failed to write config file: %s", strerror(errno));
+            close(fd);
+            unlink(temp_path);
+            return 0;
+        }
+        written += len;
+    }
+    if (fsync(fd) == -1 || close(fd) == -1) {
+        snprintf(error, error_size, "Failed to write config file: %s", strerror(errno));
+        unlink(temp_path);
+        return 0;
+    }
+    if (rename(temp_path, config_path) == -1) {
+        snprintf(error, error_size, "Failed to replace config file: %s", strerror(errno));
+        unlink(temp_path);
+        return 0;
+    }
+    return 1;
 }
 
 int ms_to_s(int ms) {
@@ -381,144 +712,4626 @@ int s_to_ms(int s) {
     return s * 1000;
 }
 
-void set_tooltip(GtkWidget *widget, const char *text) {
-    gtk_widget_set_tooltip_text(widget, text);
-}
+static volatile sig_atomic_t daemon_stop_requested = 0;
+static int daemon_reload_requested = 0;
+static int daemon_reload_forced = 0;
+static int last_reload_ok = 1;
+static int status_changed = 0;
+static char last_reload_error[MAX_ERROR_LENGTH];
+static int daemon_status_requested = 0;
+static int daemon_signal_fd = -1;
+static time_t daemon_start_time = 0;
+static char daemon_log_path[MAX_PATH_LENGTH];
 
-GtkWidget *create_label_with_tooltip(const char *label_text, const char *tooltip_text) {
-    GtkWidget *label = gtk_label_new(label_text);
-    gtk_widget_set_halign(label, GTK_ALIGN_START);
-    gtk_widget_set_tooltip_text(label, tooltip_text);
-    return label;
+/*
+ * Log lines are formatted into an in-memory buffer and written with one write() at the end of
+ * each iteration, when the buffer fills, or at once for warnings and errors. The file size is
+ * tracked from the bytes written; past MAX_LOG_SIZE the file is renamed to .1 (.1 to .2, ...).
+ */
+static int log_fd = -1;
+static long log_size = 0;
+static char log_buffer[LOG_BUFFER_SIZE];
+static size_t log_buffer_length = 0;
+static time_t log_timestamp_second = -1;
+static char log_timestamp[32];
+static size_t log_timestamp_length = 0;
+
+static void open_log_file(void) {
+    log_fd = open(daemon_log_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    struct stat st;
+    log_size = log_fd != -1 && fstat(log_fd, &st) == 0 ? st.st_size : 0;
 }
 
-void update_ui_values(void) {
-    char buffer[20];
-    snprintf(buffer, sizeof(buffer), "%d", ms_to_s(inactivity_timeout));
-    gtk_entry_set_text(GTK_ENTRY(inactivity_timeout_entry), buffer);
+static void rotate_log_file(void) {
+    char from[MAX_PATH_LENGTH + 16];
+    char to[MAX_PATH_LENGTH + 16];
 
-    snprintf(buffer, sizeof(buffer), "%d", ms_to_s(long_running_apps_timeout));
-    gtk_entry_set_text(GTK_ENTRY(long_running_apps_timeout_entry), buffer);
+    close(log_fd);
+    for (int i = LOG_ROTATE_COUNT - 1; i >= 1; i--) {
+        snprintf(from, sizeof(from), "%s.%d", daemon_log_path, i);
+        snprintf(to, sizeof(to), "%s.%d", daemon_log_path, i + 1);
+        rename(from, to);
+    }
+    snprintf(to, sizeof(to), "%s.1", daemon_log_path);
+    rename(daemon_log_path, to);
+    open_log_file();
+}
 
-    snprintf(buffer, sizeof(buffer), "%d", check_interval);
-    gtk_entry_set_text(GTK_ENTRY(check_interval_entry), buffer);
+void daemon_log_flush(void) {
+    if (log_buffer_length == 0) {
+        return;
+    }
+    if (log_fd == -1) {
+        open_log_file();
+    }
+    if (log_fd != -1) {
+        size_t written = 0;
+        while (written < log_buffer_length) {
+            ssize_t len = write(log_fd, log_buffer + written, log_buffer_length - written);
+            if (len == -1 && errno == EINTR) {
+                continue;
+            }
+            if (len <= 0) {
+                break;
+            }
+            written += len;
+        }
+        log_size += written;
+        if (log_size > MAX_LOG_SIZE) {
+            rotate_log_file();
+        }
+    }
+    log_buffer_length = 0;
+}
 
-    snprintf(buffer, sizeof(buffer), "%d", cpu_threshold);
-    gtk_entry_set_text(GTK_ENTRY(cpu_threshold_entry), buffer);
+void close_daemon_log(void) {
+    daemon_log_flush();
+    if (log_fd != -1) {
+        close(log_fd);
+        log_fd = -1;
+    }
+}
 
-    snprintf(buffer, sizeof(buffer), "%d", io_threshold);
-    gtk_entry_set_text(GTK_ENTRY(io_threshold_entry), buffer);
+static void update_log_timestamp(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    if (now.tv_sec == log_timestamp_second) {
+        return;
+    }
+    struct tm tm_now;
+    localtime_r(&now.tv_sec, &tm_now);
+    log_timestamp_length = strftime(log_timestamp, sizeof(log_timestamp), "%Y-%m-%d %H:%M:%S - ", &tm_now);
+    log_timestamp_second = now.tv_sec;
+}
 
-    snprintf(buffer, sizeof(buffer), "%d", net_threshold);
-    gtk_entry_set_text(GTK_ENTRY(net_threshold_entry), buffer);
+void daemon_log(int level, const char *format, ...) {
+    if (level > log_level) {
+        return;
+    }
 
-    snprintf(buffer, sizeof(buffer), "%d", cpu_net_check_interval);
-    gtk_entry_set_text(GTK_ENTRY(cpu_net_check_interval_entry), buffer);
+    if (log_buffer_length + LOG_LINE_MAX > sizeof(log_buffer)) {
+        daemon_log_flush();
+    }
 
-    snprintf(buffer, sizeof(buffer), "%d", io_check_interval);
-    gtk_entry_set_text(GTK_ENTRY(io_check_interval_entry), buffer);
+    update_log_timestamp();
+    memcpy(log_buffer + log_buffer_length, log_timestamp, log_timestamp_length);
+    size_t length = log_buffer_length + log_timestamp_length;
 
-    snprintf(buffer, sizeof(buffer), "%d", boot_grace_period);
-    gtk_entry_set_text(GTK_ENTRY(boot_grace_period_entry), buffer);
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(log_buffer + length, LOG_LINE_MAX - log_timestamp_length - 1, format, args);
+    va_end(args);
+    if (len < 0) {
+        return;
+    }
+    length += (size_t)len < LOG_LINE_MAX - log_timestamp_length - 1 ? (size_t)len : LOG_LINE_MAX - log_timestamp_length - 2;
+    log_buffer[length++] = '\n';
+    log_buffer_length = length;
 
-    gtk_combo_box_set_active(GTK_COMBO_BOX(action_combo_box), action_type);
+    if (level <= LOG_LEVEL_WARNING) {
+        daemon_log_flush();
+    }
+}
 
-    gtk_entry_set_text(GTK_ENTRY(custom_long_running_apps_entry), custom_long_running_apps);
-    gtk_entry_set_text(GTK_ENTRY(sleep_command_entry), sleep_command);
-    gtk_entry_set_text(GTK_ENTRY(shutdown_command_entry), shutdown_command);
-    gtk_entry_set_text(GTK_ENTRY(custom_no_gui_command_entry), custom_no_gui_command);
+/*
+ * Every iteration appends one fixed-size record to ~/.XorgIdleManager/samples.ring, a file of
+ * SAMPLE_RING_CAPACITY records mapped shared. Appending is a memcpy into the next slot followed
+ * by a release store of the record count, so a concurrent reader never sees a half-written
+ * count. The file is created once and never rewritten.
+ */
+#define SAMPLE_RING_MAGIC 0x31504d534d4958ULL /* "XIMSMP1" */
+
+enum sample_flag {
+    SAMPLE_FLAG_GUI = 1 << 0,
+    SAMPLE_FLAG_LONG_RUNNING = 1 << 1,
+    SAMPLE_FLAG_USER_ACTIVE = 1 << 2,
+    SAMPLE_FLAG_SAMPLED = 1 << 3,
+    SAMPLE_FLAG_CPU_ACTIVE = 1 << 4,
+    SAMPLE_FLAG_IO_ACTIVE = 1 << 5,
+    SAMPLE_FLAG_NET_ACTIVE = 1 << 6,
+    SAMPLE_FLAG_ACTION = 1 << 7,
+    SAMPLE_FLAG_BOOTING = 1 << 8,
+    SAMPLE_FLAG_PRESSURE = 1 << 9
+};
+
+struct sample_record {
+    int64_t timestamp_ms;
+    int32_t idle_ms;
+    uint32_t flags;
+    float cpu_usage;
+    float cpu_policy_usage;
+    float io_kbps;
+    float net_kbps;
+    float cpu_pressure;
+    float io_pressure;
+    float memory_pressure;
+};
+
+struct sample_ring_header {
+    uint64_t magic;
+    uint32_t record_size;
+    uint32_t capacity;
+    uint64_t count;
+    uint64_t reserved[5];
+};
+
+static struct sample_ring_header *sample_ring = NULL;
+static struct sample_record *sample_ring_records = NULL;
+static struct sample_record iteration_record;
+
+static size_t sample_ring_size(void) {
+    return sizeof(struct sample_ring_header) + (size_t)SAMPLE_RING_CAPACITY * sizeof(struct sample_record);
+}
 
-    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(dpms_enabled_check), dpms_enabled);
-    
-    snprintf(buffer, sizeof(buffer), "%d", dpms_standby);
-    gtk_entry_set_text(GTK_ENTRY(dpms_standby_entry), buffer);
-    
-    snprintf(buffer, sizeof(buffer), "%d", dpms_suspend);
-    gtk_entry_set_text(GTK_ENTRY(dpms_suspend_entry), buffer);
-    
-    snprintf(buffer, sizeof(buffer), "%d", dpms_off);
-    gtk_entry_set_text(GTK_ENTRY(dpms_off_entry), buffer);
+static void sample_ring_path(char *path, size_t size) {
+    snprintf(path, size, "%s/.XorgIdleManager/samples.ring", getenv("HOME"));
 }
 
-void restore_defaults_sleep(GtkWidget *widget, gpointer data) {
-    inactivity_timeout = DEFAULT_INACTIVITY_TIMEOUT_SLEEP;
-    long_running_apps_timeout = DEFAULT_LONG_RUNNING_APPS_TIMEOUT_SLEEP;
-    check_interval = DEFAULT_CHECK_INTERVAL;
-    cpu_threshold = DEFAULT_CPU_THRESHOLD;
-    io_threshold = DEFAULT_IO_THRESHOLD;
-    net_threshold = DEFAULT_NET_THRESHOLD;
-    cpu_net_check_interval = DEFAULT_CPU_NET_CHECK_INTERVAL;
-    io_check_interval = DEFAULT_IO_CHECK_INTERVAL;
-    action_type = DEFAULT_ACTION_TYPE_SLEEP;
+static int sample_ring_header_valid(const struct sample_ring_header *header) {
+    return header->magic == SAMPLE_RING_MAGIC && header->record_size == sizeof(struct sample_record) &&
+           header->capacity == SAMPLE_RING_CAPACITY;
+}
 
-    strncpy(custom_long_running_apps, DEFAULT_CUSTOM_LONG_RUNNING_APPS, sizeof(custom_long_running_apps) - 1);
-    strncpy(sleep_command, DEFAULT_SLEEP_COMMAND, sizeof(sleep_command) - 1);
-    custom_long_running_apps[sizeof(custom_long_running_apps) - 1] = '\0';
-    sleep_command[sizeof(sleep_command) - 1] = '\0';
+void open_sample_ring(void) {
+    char path[MAX_PATH_LENGTH];
+    sample_ring_path(path, sizeof(path));
 
-    update_ui_values();
-}
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        daemon_log(LOG_LEVEL_WARNING, "Cannot open sample ring %s: %s", path, strerror(errno));
+        return;
+    }
 
-void restore_defaults_shutdown(GtkWidget *widget, gpointer data) {
-    inactivity_timeout = DEFAULT_INACTIVITY_TIMEOUT_SHUTDOWN;
-    long_running_apps_timeout = DEFAULT_LONG_RUNNING_APPS_TIMEOUT_SHUTDOWN;
-    check_interval = DEFAULT_CHECK_INTERVAL;
-    cpu_threshold = DEFAULT_CPU_THRESHOLD;
-    io_threshold = DEFAULT_IO_THRESHOLD;
-    net_threshold = DEFAULT_NET_THRESHOLD;
-    cpu_net_check_interval = DEFAULT_CPU_NET_CHECK_INTERVAL;
-    io_check_interval = DEFAULT_IO_CHECK_INTERVAL;
-    action_type = DEFAULT_ACTION_TYPE_SHUTDOWN;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (st.st_size != (off_t)sample_ring_size() && ftruncate(fd, sample_ring_size()) == -1)) {
+        daemon_log(LOG_LEVEL_WARNING, "Cannot size sample ring %s: %s", path, strerror(errno));
+        close(fd);
+        return;
+    }
 
-    strncpy(custom_long_running_apps, DEFAULT_CUSTOM_LONG_RUNNING_APPS, sizeof(custom_long_running_apps) - 1);
-    strncpy(shutdown_command, DEFAULT_SHUTDOWN_COMMAND, sizeof(shutdown_command) - 1);
-    custom_long_running_apps[sizeof(custom_long_running_apps) - 1] = '\0';
-    shutdown_command[sizeof(shutdown_command) - 1] = '\0';
+    void *map = mmap(NULL, sample_ring_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        daemon_log(LOG_LEVEL_WARNING, "Cannot map sample ring %s: %s", path, strerror(errno));
+        return;
+    }
 
-    update_ui_values();
+    sample_ring = map;
+    sample_ring_records = (struct sample_record *)(sample_ring + 1);
+    if (!sample_ring_header_valid(sample_ring)) {
+        memset(sample_ring, 0, sizeof(*sample_ring));
+        sample_ring->record_size = sizeof(struct sample_record);
+        sample_ring->capacity = SAMPLE_RING_CAPACITY;
+        __atomic_store_n(&sample_ring->magic, SAMPLE_RING_MAGIC, __ATOMIC_RELEASE);
+    }
 }
 
-void restore_defaults_custom_no_gui(GtkWidget *widget, gpointer data) {
-    inactivity_timeout = DEFAULT_INACTIVITY_TIMEOUT_NO_GUI;
-    long_running_apps_timeout = DEFAULT_LONG_RUNNING_APPS_TIMEOUT_NO_GUI;
-    check_interval = DEFAULT_CHECK_INTERVAL;
-    cpu_threshold = DEFAULT_CPU_THRESHOLD;
-    io_threshold = DEFAULT_IO_THRESHOLD;
-    net_threshold = DEFAULT_NET_THRESHOLD;
-    cpu_net_check_interval = DEFAULT_CPU_NET_CHECK_INTERVAL;
-    io_check_interval = DEFAULT_IO_CHECK_INTERVAL;
-    action_type = DEFAULT_ACTION_TYPE_SHUTDOWN;
+void close_sample_ring(void) {
+    if (sample_ring != NULL) {
+        munmap(sample_ring, sample_ring_size());
+        sample_ring = NULL;
+        sample_ring_records = NULL;
+    }
+}
 
-    strncpy(custom_long_running_apps, DEFAULT_CUSTOM_LONG_RUNNING_APPS, sizeof(custom_long_running_apps) - 1);
-    strncpy(custom_no_gui_command, DEFAULT_CUSTOM_NO_GUI_COMMAND, sizeof(custom_no_gui_command) - 1);
-    custom_long_running_apps[sizeof(custom_long_running_apps) - 1] = '\0';
-    custom_no_gui_command[sizeof(custom_no_gui_command) - 1] = '\0';
+static void begin_sample_record(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    memset(&iteration_record, 0, sizeof(iteration_record));
+    iteration_record.timestamp_ms = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    iteration_record.idle_ms = -1;
+}
 
-    update_ui_values();
+static void append_sample_record(void) {
+    if (sample_ring == NULL) {
+        return;
+    }
+    uint64_t count = sample_ring->count;
+    memcpy(&sample_ring_records[count % SAMPLE_RING_CAPACITY], &iteration_record, sizeof(iteration_record));
+    __atomic_store_n(&sample_ring->count, count + 1, __ATOMIC_RELEASE);
 }
 
-int validate_script_command(const char *command) {
-    if (!command || strlen(command) < 1) return 0;
+/* Accepts epoch seconds, "-30m"-style offsets from now (s, m, h, d) or "YYYY-MM-DD[ HH:MM[:SS]]". */
+static int parse_sample_time(const char *text, int64_t *ms) {
+    char *end;
+    if (text[0] == '-') {
+        long amount = strtol(text + 1, &end, 10);
+        long unit = *end == 's' || *end == '\0' ? 1 : *end == 'm' ? 60 : *end == 'h' ? 3600 : *end == 'd' ? 86400 : 0;
+        if (end == text + 1 || unit == 0 || (*end != '\0' && end[1] != '\0')) {
+            return 0;
+        }
+        *ms = ((int64_t)time(NULL) - (int64_t)amount * unit) * 1000;
+        return 1;
+    }
+
+    long long seconds = strtoll(text, &end, 10);
+    if (end != text && *end == '\0') {
+        *ms = (int64_t)seconds * 1000;
+        return 1;
+    }
+
+    static const char *formats[] = {"%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d"};
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        struct tm tm = {0};
+        const char *rest = strptime(text, formats[i], &tm);
+        if (rest != NULL && *rest == '\0') {
+            tm.tm_isdst = -1;
+            *ms = (int64_t)mktime(&tm) * 1000;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void print_sample_record(FILE *out, const struct sample_record *record, int json, int first) {
+    char timestamp[32];
+    time_t seconds = record->timestamp_ms / 1000;
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &tm);
+
+    uint32_t f = record->flags;
+    if (json) {
+        fprintf(out, "%s{\"time\":\"%s.%03d\",\"idle_ms\":%d,\"cpu\":%.2f,\"cpu_policy\":%.2f,\"io_kbps\":%.2f,\"net_kbps\":%.2f,"
+               "\"gui\":%d,\"long_running\":%d,\"user_active\":%d,\"sampled\":%d,\"cpu_active\":%d,\"io_active\":%d,"
+               "\"net_active\":%d,\"action\":%d,\"booting\":%d,\"pressure\":%d,\"cpu_pressure\":%.2f,"
+               "\"io_pressure\":%.2f,\"memory_pressure\":%.2f}",
+               first ? "\n  " : ",\n  ", timestamp, (int)(record->timestamp_ms % 1000), record->idle_ms,
+               record->cpu_usage, record->cpu_policy_usage, record->io_kbps, record->net_kbps,
+               !!(f & SAMPLE_FLAG_GUI), !!(f & SAMPLE_FLAG_LONG_RUNNING), !!(f & SAMPLE_FLAG_USER_ACTIVE),
+               !!(f & SAMPLE_FLAG_SAMPLED), !!(f & SAMPLE_FLAG_CPU_ACTIVE), !!(f & SAMPLE_FLAG_IO_ACTIVE),
+               !!(f & SAMPLE_FLAG_NET_ACTIVE), !!(f & SAMPLE_FLAG_ACTION), !!(f & SAMPLE_FLAG_BOOTING),
+               !!(f & SAMPLE_FLAG_PRESSURE), record->cpu_pressure, record->io_pressure, record->memory_pressure);
+    } else {
+        fprintf(out, "%s.%03d,%d,%.2f,%.2f,%.2f,%.2f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.2f,%.2f,%.2f\n",
+               timestamp, (int)(record->timestamp_ms % 1000), record->idle_ms,
+               record->cpu_usage, record->cpu_policy_usage, record->io_kbps, record->net_kbps,
+               !!(f & SAMPLE_FLAG_GUI), !!(f & SAMPLE_FLAG_LONG_RUNNING), !!(f & SAMPLE_FLAG_USER_ACTIVE),
+               !!(f & SAMPLE_FLAG_SAMPLED), !!(f & SAMPLE_FLAG_CPU_ACTIVE), !!(f & SAMPLE_FLAG_IO_ACTIVE),
+               !!(f & SAMPLE_FLAG_NET_ACTIVE), !!(f & SAMPLE_FLAG_ACTION), !!(f & SAMPLE_FLAG_BOOTING),
+               !!(f & SAMPLE_FLAG_PRESSURE), record->cpu_pressure, record->io_pressure, record->memory_pressure);
+    }
+}
+
+static void write_sample_records(FILE *out, const struct sample_ring_header *header, int64_t since, int64_t until, int json) {
+    const struct sample_record *records = (const struct sample_record *)(header + 1);
+
+    uint64_t count = __atomic_load_n(&header->count, __ATOMIC_ACQUIRE);
+    uint64_t first = count > SAMPLE_RING_CAPACITY ? count - SAMPLE_RING_CAPACITY : 0;
+
+    if (json) {
+        fprintf(out, "[");
+    } else {
+        fprintf(out, "time,idle_ms,cpu,cpu_policy,io_kbps,net_kbps,gui,long_running,user_active,sampled,cpu_active,io_active,net_active,action,booting,pressure,cpu_pressure,io_pressure,memory_pressure\n");
+    }
+
+    int printed = 0;
+    for (uint64_t i = first; i < count; i++) {
+        struct sample_record record = records[i % SAMPLE_RING_CAPACITY];
+        /*
+         * The daemon may have lapped this slot while we were reading it. Slot i is being
+         * overwritten as soon as count reaches i + SAMPLE_RING_CAPACITY, before count moves on.
+         */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header->count, __ATOMIC_ACQUIRE) - i >= SAMPLE_RING_CAPACITY) {
+            continue;
+        }
+        if (record.timestamp_ms < since || record.timestamp_ms > until) {
+            continue;
+        }
+        print_sample_record(out, &record, json, printed == 0);
+        printed++;
+    }
+
+    if (json) {
+        fprintf(out, "%s]\n", printed ? "\n" : "");
+    }
+}
+
+/* XorgIdleManager --samples [--since T] [--until T] [--format csv|json] */
+int run_samples_query(int argc, char *argv[]) {
+    int64_t since = INT64_MIN, until = INT64_MAX;
+    int json = 0;
+
+    for (int i = 2; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--since") == 0 && value != NULL && parse_sample_time(value, &since)) {
+            i++;
+        } else if (strcmp(argv[i], "--until") == 0 && value != NULL && parse_sample_time(value, &until)) {
+            i++;
+        } else if (strcmp(argv[i], "--format") == 0 && value != NULL && (strcmp(value, "csv") == 0 || strcmp(value, "json") == 0)) {
+            json = strcmp(value, "json") == 0;
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s --samples [--since TIME] [--until TIME] [--format csv|json]\n"
+                            "TIME is epoch seconds, an offset such as -30m, -2h or -1d, or YYYY-MM-DD[ HH:MM[:SS]].\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (getenv("HOME") == NULL) {
+        fprintf(stderr, "Environment variable HOME is not defined.\n");
+        return EXIT_FAILURE;
+    }
+
+    char path[MAX_PATH_LENGTH];
+    sample_ring_path(path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1 || st.st_size != (off_t)sample_ring_size()) {
+        fprintf(stderr, "No sample history found at %s\n", path);
+        if (fd != -1) close(fd);
+        return EXIT_FAILURE;
+    }
+
+    const struct sample_ring_header *header = mmap(NULL, sample_ring_size(), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED || !sample_ring_header_valid(header)) {
+        fprintf(stderr, "Sample history at %s is not readable\n", path);
+        return EXIT_FAILURE;
+    }
+
+    write_sample_records(stdout, header, since, until, json);
+    munmap((void *)header, sample_ring_size());
+    return EXIT_SUCCESS;
+}
+
+static long long monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* SIGTERM, SIGINT, SIGHUP and SIGUSR1 stay blocked in the daemon and are read from this signalfd. */
+static void read_daemon_signals(void) {
+    struct signalfd_siginfo info;
+    while (daemon_signal_fd != -1 && read(daemon_signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+        if (info.ssi_signo == SIGTERM || info.ssi_signo == SIGINT) {
+            daemon_stop_requested = 1;
+        } else if (info.ssi_signo == SIGHUP) {
+            daemon_reload_requested = 1;
+            daemon_reload_forced = 1;
+        } else if (info.ssi_signo == SIGUSR1) {
+            daemon_status_requested = 1;
+        }
+    }
+}
+
+/* The fallback when epoll_wait itself fails; waits on the signalfd, so a stop request still ends it. */
+static void daemon_sleep(int seconds) {
+    long long deadline = monotonic_ms() + (long long)seconds * 1000;
+    struct pollfd fd = {daemon_signal_fd, POLLIN, 0};
+    while (!daemon_stop_requested) {
+        long long remaining = deadline - monotonic_ms();
+        if (remaining <= 0) {
+            break;
+        }
+        if (poll(&fd, 1, remaining > INT_MAX ? INT_MAX : (int)remaining) > 0) {
+            read_daemon_signals();
+        }
+    }
+}
+
+static long read_uptime_seconds(void) {
+    FILE *fp = fopen("/proc/uptime", "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    double uptime = 0;
+    if (fscanf(fp, "%lf", &uptime) != 1) {
+        uptime = -1;
+    }
+    fclose(fp);
+    return (long)uptime;
+}
+
+int is_system_booting(void) {
+    long minutes = read_uptime_seconds() / 60;
+
+    if (minutes < boot_grace_period) {
+        daemon_log(LOG_LEVEL_DEBUG, "System is in boot grace period (%ld minutes < boot grace period of %d minutes)", minutes, boot_grace_period);
+        return 1;
+    }
+
+    daemon_log(LOG_LEVEL_DEBUG, "System boot grace period has passed (boot grace period: %d minutes)", boot_grace_period);
+    return 0;
+}
+
+/* Slot 0 holds the aggregate "cpu" line, slot N + 1 holds "cpuN". */
+struct cpu_times {
+    int slots;
+    unsigned long long total[MAX_CPUS + 1];
+    unsigned long long idle[MAX_CPUS + 1];
+};
+
+static int proc_stat_fd = -1;
+static char proc_stat_buffer[PROC_STAT_BUFFER_SIZE];
+
+/* Reads every cpu line with a single pread into static storage; nothing is allocated. */
+static int read_cpu_times(struct cpu_times *times) {
+    if (proc_stat_fd == -1) {
+        proc_stat_fd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+        if (proc_stat_fd == -1) {
+            return 0;
+        }
+    }
+
+    ssize_t len = pread(proc_stat_fd, proc_stat_buffer, sizeof(proc_stat_buffer) - 1, 0);
+    if (len <= 0) {
+        return 0;
+    }
+    proc_stat_buffer[len] = '\0';
+
+    memset(times, 0, sizeof(*times));
+    char *line = proc_stat_buffer;
+    while (strncmp(line, "cpu", 3) == 0) {
+        char *p = line + 3;
+        int slot = 0;
+        if (isdigit((unsigned char)*p)) {
+            slot = (int)strtol(p, &p, 10) + 1;
+        }
+
+        /* user nice system idle iowait irq softirq steal; guest time is already part of user. */
+        unsigned long long fields[8] = {0};
+        for (int i = 0; i < 8; i++) {
+            fields[i] = strtoull(p, &p, 10);
+        }
+
+        if (slot <= MAX_CPUS) {
+            times->total[slot] = fields[0] + fields[1] + fields[2] + fields[3] + fields[4] + fields[5] + fields[6] + fields[7];
+            /* A CPU waiting on disk is not busy; slow storage shows up in the I/O signal instead. */
+            times->idle[slot] = fields[3] + fields[4];
+            if (slot >= times->slots) {
+                times->slots = slot + 1;
+            }
+        }
+
+        char *next = strchr(p, '\n');
+        if (next == NULL) {
+            break;
+        }
+        line = next + 1;
+    }
+
+    return times->slots > 0;
+}
+
+struct activity_sample {
+    double cpu_usage;
+    double cpu_core_usage[MAX_CPUS];
+    int cpu_cores;
+    int cpu_busiest_core;
+    double cpu_policy_usage;
+    double read_activity;
+    double write_activity;
+    double io_activity;
+    int io_busiest_device;
+    double net_activity;
+    char net_busiest_interface[IFNAMSIZ];
+    int cpu_active;
+    int io_active;
+    int net_active;
+    double excluded_cpu_usage;
+    double excluded_io_activity;
+    double cgroup_cpu_usage;
+    double cgroup_io_activity;
+    double cpu_pressure;
+    double io_pressure;
+    int cgroup_cpu_active;
+    int cgroup_io_active;
+    double window_seconds;
+};
+
+static double counter_rate(unsigned long long start, unsigned long long end, double seconds) {
+    return end < start ? 0.0 : (double)(end - start) / seconds;
+}
+
+/*
+ * Block devices seen in /proc/diskstats, in order of first appearance. Counter arrays in
+ * snapshots are indexed by position in this table, so entries are only ever appended.
+ */
+struct disk_device {
+    char name[32];
+    int partition;
+    int parent;
+    int counted;
+};
+
+struct disk_counters {
+    int count;
+    unsigned long long read_sectors[MAX_DISKS];
+    unsigned long long write_sectors[MAX_DISKS];
+};
+
+static struct disk_device disk_devices[MAX_DISKS];
+static int disk_device_count = 0;
+static int proc_diskstats_fd = -1;
+static char proc_diskstats_buffer[PROC_DISKSTATS_BUFFER_SIZE];
+
+/* Matches name against a '|'-separated list of glob patterns. */
+int pattern_list_matches(const char *list, const char *name) {
+    const char *p = list;
+    while (*p) {
+        size_t len = strcspn(p, "|");
+        char pattern[128];
+        if (len > 0 && len < sizeof(pattern)) {
+            memcpy(pattern, p, len);
+            pattern[len] = '\0';
+            if (fnmatch(pattern, name, 0) == 0) {
+                return 1;
+            }
+        }
+        p += len;
+        if (*p == '|') p++;
+    }
+    return 0;
+}
+
+static int find_disk_device(const char *name);
+
+/* sysfs tells whether a device is a partition and which disk it belongs to. */
+static int add_disk_device(const char *name) {
+    if (disk_device_count >= MAX_DISKS) {
+        return -1;
+    }
+
+    char sys_name[32];
+    snprintf(sys_name, sizeof(sys_name), "%s", name);
+    for (char *p = sys_name; *p; p++) {
+        if (*p == '/') *p = '!';
+    }
+
+    char sys_path[MAX_PATH_LENGTH];
+    char resolved[PATH_MAX];
+    int partition = 0;
+    int parent = -1;
+
+    snprintf(sys_path, sizeof(sys_path), "/sys/class/block/%s/partition", sys_name);
+    if (access(sys_path, F_OK) == 0) {
+        partition = 1;
+        snprintf(sys_path, sizeof(sys_path), "/sys/class/block/%s", sys_name);
+        if (realpath(sys_path, resolved) != NULL) {
+            char *slash = strrchr(resolved, '/');
+            if (slash != NULL) {
+                *slash = '\0';
+                slash = strrchr(resolved, '/');
+                if (slash != NULL) {
+                    for (char *p = slash + 1; *p; p++) {
+                        if (*p == '!') *p = '/';
+                    }
+                    parent = find_disk_device(slash + 1);
+                }
+            }
+        }
+    }
+
+    int index = disk_device_count++;
+    struct disk_device *device = &disk_devices[index];
+    snprintf(device->name, sizeof(device->name), "%s", name);
+    device->partition = partition;
+    device->parent = parent;
+
+    int selected = (io_devices_include[0] == '\0' || pattern_list_matches(io_devices_include, name)) &&
+                   !pattern_list_matches(io_devices_exclude, name);
+    /* A partition only counts on its own when its whole disk is not already counted. */
+    device->counted = selected && !(partition && parent >= 0 && disk_devices[parent].counted);
+    return index;
+}
+
+static int find_disk_device(const char *name) {
+    for (int i = 0; i < disk_device_count; i++) {
+        if (strcmp(disk_devices[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return add_disk_device(name);
+}
+
+void reset_disk_devices(void) {
+    disk_device_count = 0;
+}
+
+static int read_disk_counters(struct disk_counters *counters) {
+    if (proc_diskstats_fd == -1) {
+        proc_diskstats_fd = open("/proc/diskstats", O_RDONLY | O_CLOEXEC);
+        if (proc_diskstats_fd == -1) {
+            return 0;
+        }
+    }
+
+    ssize_t len = pread(proc_diskstats_fd, proc_diskstats_buffer, sizeof(proc_diskstats_buffer) - 1, 0);
+    if (len <= 0) {
+        return 0;
+    }
+    proc_diskstats_buffer[len] = '\0';
+
+    memset(counters, 0, sizeof(*counters));
+    char *line = proc_diskstats_buffer;
+    while (*line) {
+        char name[32];
+        unsigned long long sectors_read, sectors_written;
+        if (sscanf(line, " %*u %*u %31s %*u %*u %llu %*u %*u %*u %llu",
+                   name, &sectors_read, &sectors_written) == 3) {
+            int index = find_disk_device(name);
+            if (index >= 0) {
+                counters->read_sectors[index] = sectors_read;
+                counters->write_sectors[index] = sectors_written;
+            }
+        }
+
+        char *next = strchr(line, '\n');
+        if (next == NULL) {
+            break;
+        }
+        line = next + 1;
+    }
+
+    counters->count = disk_device_count;
+    return 1;
+}
+
+/* Per-device KB/s from sector deltas (sectors are always 512 bytes in diskstats). */
+static void evaluate_disk_activity(const struct disk_counters *start, const struct disk_counters *end,
+                                   double seconds, struct activity_sample *sample) {
+    int count = start->count < end->count ? start->count : end->count;
+
+    sample->read_activity = 0;
+    sample->write_activity = 0;
+    sample->io_busiest_device = -1;
+    double busiest = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (!disk_devices[i].counted) {
+            continue;
+        }
+        double read_kbps = counter_rate(start->read_sectors[i], end->read_sectors[i], seconds) / 2.0;
+        double write_kbps = counter_rate(start->write_sectors[i], end->write_sectors[i], seconds) / 2.0;
+        sample->read_activity += read_kbps;
+        sample->write_activity += write_kbps;
+        if (read_kbps + write_kbps > busiest) {
+            busiest = read_kbps + write_kbps;
+            sample->io_busiest_device = i;
+        }
+        if (read_kbps + write_kbps > 0) {
+            daemon_log(LOG_LEVEL_DEBUG, "I/O on %s: read %.2f KB/s, write %.2f KB/s", disk_devices[i].name, read_kbps, write_kbps);
+        }
+    }
+}
+
+/*
+ * Network interfaces keyed by ifindex in an open-addressed table. Snapshots record the
+ * ifindex owning each slot, so a slot recycled between two snapshots never yields a delta.
+ */
+struct net_interface {
+    int ifindex;
+    unsigned int generation;
+    char name[IFNAMSIZ];
+    char kind[16];
+    int counted;
+};
+
+struct net_counters {
+    int ifindex[MAX_INTERFACES];
+    unsigned long long rx_bytes[MAX_INTERFACES];
+    unsigned long long tx_bytes[MAX_INTERFACES];
+};
+
+static struct net_interface net_interfaces[MAX_INTERFACES];
+static unsigned int net_generation = 0;
+static int rtnetlink_fd = -1;
+static unsigned int rtnetlink_seq = 0;
+/* Grown when a dump message is larger, which hosts with many links or VFs can produce. */
+static char *rtnetlink_buffer = NULL;
+static size_t rtnetlink_buffer_size = 0;
+
+#define NET_SLOT_DELETED (-1)
+
+static int find_net_interface_slot(int ifindex) {
+    int free_slot = -1;
+    for (int probe = 0; probe < MAX_INTERFACES; probe++) {
+        int slot = (ifindex + probe) % MAX_INTERFACES;
+        if (net_interfaces[slot].ifindex == ifindex) {
+            return slot;
+        }
+        if (net_interfaces[slot].ifindex == NET_SLOT_DELETED && free_slot < 0) {
+            free_slot = slot;
+        } else if (net_interfaces[slot].ifindex == 0) {
+            return free_slot >= 0 ? free_slot : slot;
+        }
+    }
+    return free_slot;
+}
+
+static void classify_net_interface(struct net_interface *interface) {
+    if (net_interfaces_include[0] != '\0') {
+        interface->counted = pattern_list_matches(net_interfaces_include, interface->name) &&
+                             !pattern_list_matches(net_interfaces_exclude, interface->name);
+    } else {
+        interface->counted = !pattern_list_matches(net_interfaces_exclude, interface->name) &&
+                             !(interface->kind[0] != '\0' && pattern_list_matches(net_kinds_exclude, interface->kind));
+    }
+}
+
+void reset_net_interfaces(void) {
+    memset(net_interfaces, 0, sizeof(net_interfaces));
+}
+
+static void record_net_link(struct ifinfomsg *info, int length, struct net_counters *counters) {
+    const char *name = NULL;
+    const char *kind = "";
+    struct rtnl_link_stats64 stats;
+    int have_stats = 0;
+
+    for (struct rtattr *attr = IFLA_RTA(info); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+        if (attr->rta_type == IFLA_IFNAME) {
+            name = RTA_DATA(attr);
+        } else if (attr->rta_type == IFLA_STATS64 && RTA_PAYLOAD(attr) >= 4 * sizeof(__u64)) {
+            /* The kernel's struct may be shorter or longer than this header's; only the leading byte counters are used. */
+            size_t copy = RTA_PAYLOAD(attr) < sizeof(stats) ? RTA_PAYLOAD(attr) : sizeof(stats);
+            memset(&stats, 0, sizeof(stats));
+            memcpy(&stats, RTA_DATA(attr), copy);
+            have_stats = 1;
+        } else if (attr->rta_type == IFLA_LINKINFO) {
+            int nested_length = RTA_PAYLOAD(attr);
+            for (struct rtattr *nested = RTA_DATA(attr); RTA_OK(nested, nested_length); nested = RTA_NEXT(nested, nested_length)) {
+                if (nested->rta_type == IFLA_INFO_KIND) {
+                    kind = RTA_DATA(nested);
+                }
+            }
+        }
+    }
+
+    if (name == NULL || !have_stats) {
+        return;
+    }
+
+    int slot = find_net_interface_slot(info->ifi_index);
+    if (slot < 0) {
+        return;
+    }
+
+    struct net_interface *interface = &net_interfaces[slot];
+    if (interface->ifindex != info->ifi_index || strcmp(interface->name, name) != 0 || strcmp(interface->kind, kind) != 0) {
+        interface->ifindex = info->ifi_index;
+        snprintf(interface->name, sizeof(interface->name), "%s", name);
+        snprintf(interface->kind, sizeof(interface->kind), "%s", kind);
+        classify_net_interface(interface);
+    }
+    interface->generation = net_generation;
+
+    counters->ifindex[slot] = info->ifi_index;
+    counters->rx_bytes[slot] = stats.rx_bytes;
+    counters->tx_bytes[slot] = stats.tx_bytes;
+}
+
+/* Dumps every link's IFLA_STATS64 over one rtnetlink request; no files or subprocesses involved. */
+static int read_net_counters(struct net_counters *counters) {
+    if (rtnetlink_fd == -1) {
+        rtnetlink_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (rtnetlink_fd == -1) {
+            return 0;
+        }
+        /* A reply that never comes must not hang the daemon. */
+        struct timeval timeout = {1, 0};
+        setsockopt(rtnetlink_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    struct {
+        struct nlmsghdr header;
+        struct ifinfomsg info;
+    } request = {0};
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    request.header.nlmsg_type = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++rtnetlink_seq;
+    request.info.ifi_family = AF_UNSPEC;
+
+    if (send(rtnetlink_fd, &request, request.header.nlmsg_len, 0) == -1) {
+        return 0;
+    }
+
+    memset(counters, 0, sizeof(*counters));
+    net_generation++;
+
+    for (;;) {
+        /* Peek at the real length first, so no message of the dump is cut short. */
+        ssize_t len = recv(rtnetlink_fd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+        if (len > 0 && (size_t)len > rtnetlink_buffer_size) {
+            size_t size = len > RTNETLINK_BUFFER_SIZE ? (size_t)len : RTNETLINK_BUFFER_SIZE;
+            char *buffer = realloc(rtnetlink_buffer, size);
+            if (buffer == NULL) {
+                len = -1;
+            } else {
+                rtnetlink_buffer = buffer;
+                rtnetlink_buffer_size = size;
+            }
+        }
+        if (len > 0) {
+            len = recv(rtnetlink_fd, rtnetlink_buffer, rtnetlink_buffer_size, 0);
+        }
+        if (len <= 0) {
+            if (len == -1 && errno == EINTR) {
+                continue;
+            }
+            /* The rest of an abandoned dump would still be queued; start over on a new socket. */
+            close(rtnetlink_fd);
+            rtnetlink_fd = -1;
+            return 0;
+        }
+
+        for (struct nlmsghdr *header = (struct nlmsghdr *)rtnetlink_buffer; NLMSG_OK(header, len); header = NLMSG_NEXT(header, len)) {
+            if (header->nlmsg_seq != rtnetlink_seq) {
+                continue;
+            }
+            if (header->nlmsg_type == NLMSG_DONE) {
+                for (int slot = 0; slot < MAX_INTERFACES; slot++) {
+                    if (net_interfaces[slot].ifindex > 0 && net_interfaces[slot].generation != net_generation) {
+                        net_interfaces[slot].ifindex = NET_SLOT_DELETED;
+                    }
+                }
+                return 1;
+            }
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                close(rtnetlink_fd);
+                rtnetlink_fd = -1;
+                return 0;
+            }
+            if (header->nlmsg_type == RTM_NEWLINK) {
+                struct ifinfomsg *info = NLMSG_DATA(header);
+                record_net_link(info, IFLA_PAYLOAD(header), counters);
+            }
+        }
+    }
+}
+
+static void evaluate_net_activity(const struct net_counters *start, const struct net_counters *end,
+                                  double seconds, struct activity_sample *sample) {
+    sample->net_activity = 0;
+    sample->net_busiest_interface[0] = '\0';
+    double busiest = 0;
+
+    for (int slot = 0; slot < MAX_INTERFACES; slot++) {
+        if (start->ifindex[slot] <= 0 || start->ifindex[slot] != end->ifindex[slot] ||
+            net_interfaces[slot].ifindex != end->ifindex[slot] || !net_interfaces[slot].counted) {
+            continue;
+        }
+        double rx_kbps = counter_rate(start->rx_bytes[slot], end->rx_bytes[slot], seconds) / 1024.0;
+        double tx_kbps = counter_rate(start->tx_bytes[slot], end->tx_bytes[slot], seconds) / 1024.0;
+        sample->net_activity += rx_kbps + tx_kbps;
+        if (rx_kbps + tx_kbps > busiest) {
+            busiest = rx_kbps + tx_kbps;
+            snprintf(sample->net_busiest_interface, sizeof(sample->net_busiest_interface), "%s", net_interfaces[slot].name);
+        }
+        if (rx_kbps + tx_kbps > 0) {
+            daemon_log(LOG_LEVEL_DEBUG, "Network on %s: receive %.1f KB/s, transmit %.1f KB/s", net_interfaces[slot].name, rx_kbps, tx_kbps);
+        }
+    }
+}
+
+/*
+ * cgroup v2 probe. cgroups_include and cgroups_exclude are '|'-separated paths below
+ * /sys/fs/cgroup ("/" is the root), glob patterns allowed and %U replaced by the user id, so
+ * "user.slice/user-%U.slice" is the user's own slice. usage_usec from cpu.stat and rbytes plus
+ * wbytes from io.stat are hierarchical, so each counted cgroup is the sum of the included ones
+ * minus the excluded ones below them. The patterns are expanded again every CGROUP_RESCAN_SECONDS
+ * (services come and go); between expansions the files stay open and are re-read with pread().
+ */
+#define CGROUP_RESCAN_SECONDS 60
+
+struct cgroup_file_set {
+    int cpu_fd;
+    int io_fd;
+    int sign;
+    char path[128];
+};
+
+struct cgroup_counters {
+    long long usage_usec;
+    long long io_bytes;
+    unsigned int generation;
+};
+
+static struct cgroup_file_set cgroup_files[MAX_CGROUPS];
+static int cgroup_file_count = 0;
+static unsigned int cgroup_generation = 0;
+static long long cgroup_expanded_ms = 0;
+static int cgroup_warned = 0;
+
+static int cgroup_probe_active(void) {
+    return cgroups_include[0] != '\0';
+}
+
+static void close_cgroup_files(void) {
+    for (int i = 0; i < cgroup_file_count; i++) {
+        if (cgroup_files[i].cpu_fd != -1) close(cgroup_files[i].cpu_fd);
+        if (cgroup_files[i].io_fd != -1) close(cgroup_files[i].io_fd);
+    }
+    cgroup_file_count = 0;
+    cgroup_expanded_ms = 0;
+    cgroup_generation++;
+}
+
+void reset_cgroup_files(void) {
+    close_cgroup_files();
+    cgroup_warned = 0;
+}
+
+/* True when path lies at or below one of the entries from first up to (not including) last. */
+static int cgroup_covered(const char *path, int first, int last) {
+    for (int i = first; i < last; i++) {
+        size_t length = strlen(cgroup_files[i].path);
+        if (strncmp(path, cgroup_files[i].path, length) == 0 && (path[length] == '\0' || path[length] == '/')) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void add_cgroup_files(const char *match, int sign, int included) {
+    char path[sizeof(cgroup_files[0].path)];
+    size_t length = snprintf(path, sizeof(path), "%s", match);
+    if (length >= sizeof(path) || cgroup_file_count == MAX_CGROUPS) {
+        return;
+    }
+    while (length > 1 && path[length - 1] == '/') {
+        path[--length] = '\0';
+    }
+    /* Nested entries would be counted twice; an exclude outside every include changes nothing. */
+    if (sign > 0 ? cgroup_covered(path, 0, cgroup_file_count)
+                 : !cgroup_covered(path, 0, included) || cgroup_covered(path, included, cgroup_file_count)) {
+        return;
+    }
+    struct cgroup_file_set *files = &cgroup_files[cgroup_file_count];
+    char file[PATH_MAX];
+    memcpy(files->path, path, sizeof(path));
+    snprintf(file, sizeof(file), "%s/cpu.stat", path);
+    files->cpu_fd = open(file, O_RDONLY | O_CLOEXEC);
+    snprintf(file, sizeof(file), "%s/io.stat", path);
+    files->io_fd = open(file, O_RDONLY | O_CLOEXEC);
+    files->sign = sign;
+    if (files->cpu_fd == -1 && files->io_fd == -1) {
+        return;
+    }
+    if ((files->cpu_fd == -1 || files->io_fd == -1) && !cgroup_warned) {
+        daemon_log(LOG_LEVEL_WARNING, "cgroup %s has no %s, counting it as 0", path,
+                   files->cpu_fd == -1 ? "cpu.stat" : "io.stat");
+    }
+    cgroup_file_count++;
+}
+
+static void expand_cgroup_list(const char *list, int sign, int included) {
+    char user[16];
+    snprintf(user, sizeof(user), "%d", (int)getuid());
+    const char *p = list;
+    while (*p) {
+        size_t len = strcspn(p, "|");
+        char pattern[PATH_MAX];
+        size_t used = snprintf(pattern, sizeof(pattern), "%s/", CGROUP_ROOT);
+        for (size_t i = 0; i < len && used < sizeof(pattern) - 16; i++) {
+            if (p[i] == '%' && i + 1 < len && p[i + 1] == 'U') {
+                used += snprintf(pattern + used, sizeof(pattern) - used, "%s", user);
+                i++;
+            } else {
+                pattern[used++] = p[i];
+            }
+        }
+        pattern[used] = '\0';
+
+        glob_t matches;
+        if (len > 0 && glob(pattern, GLOB_ONLYDIR, NULL, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; i++) {
+                add_cgroup_files(matches.gl_pathv[i], sign, included);
+            }
+            globfree(&matches);
+        }
+        p += len;
+        if (*p == '|') p++;
+    }
+}
+
+/* A rescan that finds the same cgroups keeps the generation, so the snapshots around it still pair up. */
+static void expand_cgroups(void) {
+    static char previous_paths[MAX_CGROUPS][sizeof(cgroup_files[0].path)];
+    int previous_count = cgroup_file_count;
+    unsigned int previous_generation = cgroup_generation;
+    for (int i = 0; i < previous_count; i++) {
+        memcpy(previous_paths[i], cgroup_files[i].path, sizeof(previous_paths[i]));
+    }
+
+    close_cgroup_files();
+    expand_cgroup_list(cgroups_include, 1, 0);
+    int included = cgroup_file_count;
+    expand_cgroup_list(cgroups_exclude, -1, included);
+    cgroup_expanded_ms = monotonic_ms();
+
+    int unchanged = previous_count > 0 && previous_count == cgroup_file_count;
+    for (int i = 0; unchanged && i < cgroup_file_count; i++) {
+        unchanged = strcmp(previous_paths[i], cgroup_files[i].path) == 0;
+    }
+    if (unchanged) {
+        cgroup_generation = previous_generation;
+    }
+
+    if (!cgroup_warned) {
+        if (included == 0) {
+            daemon_log(LOG_LEVEL_WARNING, "cgroups_include matches no cgroup v2 directory below %s", CGROUP_ROOT);
+        } else {
+            daemon_log(LOG_LEVEL_INFO, "cgroup probe: %d included, %d excluded cgroup(s)", included,
+                       cgroup_file_count - included);
+        }
+        cgroup_warned = 1;
+    }
+}
+
+static int read_cgroup_file(int fd, char *buffer, size_t size) {
+    ssize_t len = pread(fd, buffer, size - 1, 0);
+    if (len < 0) {
+        return 0;
+    }
+    buffer[len] = '\0';
+    return 1;
+}
+
+static int read_cgroup_counters(struct cgroup_counters *counters) {
+    memset(counters, 0, sizeof(*counters));
+    if (!cgroup_probe_active()) {
+        return 0;
+    }
+    if (cgroup_expanded_ms == 0 || monotonic_ms() - cgroup_expanded_ms > CGROUP_RESCAN_SECONDS * 1000LL) {
+        expand_cgroups();
+    }
+
+    char buffer[4096];
+    for (int i = 0; i < cgroup_file_count; i++) {
+        const struct cgroup_file_set *files = &cgroup_files[i];
+        if (files->cpu_fd != -1) {
+            if (!read_cgroup_file(files->cpu_fd, buffer, sizeof(buffer))) {
+                /* The cgroup was removed; expand again next time and skip this pair of snapshots. */
+                close_cgroup_files();
+                return 0;
+            }
+            char *usage = strstr(buffer, "usage_usec ");
+            if (usage != NULL) {
+                counters->usage_usec += files->sign * strtoll(usage + 11, NULL, 10);
+            }
+        }
+        if (files->io_fd != -1) {
+            if (!read_cgroup_file(files->io_fd, buffer, sizeof(buffer))) {
+                close_cgroup_files();
+                return 0;
+            }
+            for (char *p = buffer; (p = strstr(p, "bytes=")) != NULL; p += 6) {
+                if (p - buffer >= 1 && (p[-1] == 'r' || p[-1] == 'w')) {
+                    counters->io_bytes += files->sign * strtoll(p + 6, NULL, 10);
+                }
+            }
+        }
+    }
+    counters->generation = cgroup_generation;
+    return 1;
+}
+
+static void evaluate_cgroup_activity(const struct cgroup_counters *start, const struct cgroup_counters *end,
+                                     double seconds, struct activity_sample *sample) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    double usage = (double)(end->usage_usec - start->usage_usec);
+    double bytes = (double)(end->io_bytes - start->io_bytes);
+    sample->cgroup_cpu_usage = usage > 0 ? 100.0 * usage / (seconds * 1e6 * (cpus > 0 ? cpus : 1)) : 0;
+    if (sample->cgroup_cpu_usage > 100) sample->cgroup_cpu_usage = 100;
+    sample->cgroup_io_activity = bytes > 0 ? bytes / 1024.0 / seconds : 0;
+    sample->cgroup_cpu_active = sample->cgroup_cpu_usage > cgroup_cpu_threshold;
+    sample->cgroup_io_active = sample->cgroup_io_activity > cgroup_io_threshold;
+}
+
+/* Running totals of CPU ticks and storage bytes from processes on the deny- and allowlists. */
+struct process_totals {
+    unsigned long long denied_ticks;
+    unsigned long long allowed_ticks;
+    unsigned long long denied_io_bytes;
+    unsigned long long allowed_io_bytes;
+    int valid;
+};
+
+static void scan_process_activity(struct process_totals *totals);
+static int activity_allowlist_active(void);
+
+struct activity_snapshot {
+    struct cpu_times cpu;
+    struct disk_counters disk;
+    struct net_counters net;
+    struct process_totals processes;
+    struct cgroup_counters cgroups;
+    int cpu_valid;
+    int disk_valid;
+    int net_valid;
+    int cgroups_valid;
+    struct timespec taken;
+};
+
+static void take_activity_snapshot(struct activity_snapshot *snapshot) {
+    snapshot->cpu_valid = read_cpu_times(&snapshot->cpu);
+    snapshot->disk_valid = read_disk_counters(&snapshot->disk);
+    snapshot->net_valid = read_net_counters(&snapshot->net);
+    scan_process_activity(&snapshot->processes);
+    snapshot->cgroups_valid = read_cgroup_counters(&snapshot->cgroups);
+    clock_gettime(CLOCK_MONOTONIC, &snapshot->taken);
+}
+
+
+const char *cpu_policy_name(int policy) {
+    if (policy == CPU_POLICY_ANY_CORE) return "any core";
+    if (policy == CPU_POLICY_TOP_CORES) return "top cores";
+    return "aggregate";
+}
+
+/*
+ * Computes usage for the aggregate and every core in one flat pass over the slot arrays,
+ * then reduces it to the figure the configured cpu_policy compares against cpu_threshold.
+ */
+static void evaluate_cpu_policy(const struct cpu_times *start, const struct cpu_times *end, struct activity_sample *sample) {
+    static double usage[MAX_CPUS + 1];
+    int slots = start->slots < end->slots ? start->slots : end->slots;
+
+    for (int i = 0; i < slots; i++) {
+        double total = (double)end->total[i] - (double)start->total[i];
+        double busy = total - ((double)end->idle[i] - (double)start->idle[i]);
+        usage[i] = total > 0 && busy > 0 ? 100.0 * busy / total : 0.0;
+    }
+
+    sample->cpu_usage = usage[0];
+    sample->cpu_cores = slots > 1 ? slots - 1 : 0;
+    sample->cpu_busiest_core = -1;
+    memcpy(sample->cpu_core_usage, usage + 1, sample->cpu_cores * sizeof(double));
+
+    double busiest = 0;
+    for (int i = 0; i < sample->cpu_cores; i++) {
+        if (sample->cpu_busiest_core < 0 || sample->cpu_core_usage[i] > busiest) {
+            busiest = sample->cpu_core_usage[i];
+            sample->cpu_busiest_core = i;
+        }
+    }
+
+    if (cpu_policy == CPU_POLICY_ANY_CORE && sample->cpu_cores > 0) {
+        sample->cpu_policy_usage = busiest;
+    } else if (cpu_policy == CPU_POLICY_TOP_CORES && sample->cpu_cores > 0) {
+        int n = cpu_top_cores < 1 ? 1 : cpu_top_cores > sample->cpu_cores ? sample->cpu_cores : cpu_top_cores;
+        double top[MAX_CPUS];
+        int filled = 0;
+        for (int i = 0; i < sample->cpu_cores; i++) {
+            double value = sample->cpu_core_usage[i];
+            if (filled < n) {
+                filled++;
+            } else if (value <= top[n - 1]) {
+                continue;
+            }
+            int j = filled - 1;
+            while (j > 0 && top[j - 1] < value) {
+                top[j] = top[j - 1];
+                j--;
+            }
+            top[j] = value;
+        }
+        double sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += top[i];
+        }
+        sample->cpu_policy_usage = sum / n;
+    } else {
+        sample->cpu_policy_usage = sample->cpu_usage;
+    }
+}
+
+/*
+ * Takes what the deny- and allowlists say out of the CPU and I/O figures. Per-core usage is not
+ * known per process, so the policy figure is scaled by the share of aggregate CPU that remains.
+ */
+static void attribute_activity(const struct activity_snapshot *start, const struct activity_snapshot *end,
+                               double seconds, struct activity_sample *sample) {
+    const struct process_totals *before = &start->processes;
+    const struct process_totals *after = &end->processes;
+    double total_ticks = (double)end->cpu.total[0] - (double)start->cpu.total[0];
+    int allow = activity_allowlist_active();
+
+    double ticks = allow ? (double)(after->allowed_ticks - before->allowed_ticks)
+                         : (double)(after->denied_ticks - before->denied_ticks);
+    double share = total_ticks > 0 ? 100.0 * ticks / total_ticks : 0;
+    double counted = allow ? share : sample->cpu_usage - share;
+    if (counted < 0) counted = 0;
+    if (counted > sample->cpu_usage) counted = sample->cpu_usage;
+    sample->cpu_policy_usage = sample->cpu_usage > 0 ? sample->cpu_policy_usage * counted / sample->cpu_usage : 0;
+    sample->excluded_cpu_usage = sample->cpu_usage - counted;
+
+    double bytes = allow ? (double)(after->allowed_io_bytes - before->allowed_io_bytes)
+                         : (double)(after->denied_io_bytes - before->denied_io_bytes);
+    double io = bytes / 1024.0 / seconds;
+    counted = allow ? io : sample->io_activity - io;
+    if (counted < 0) counted = 0;
+    if (counted > sample->io_activity) counted = sample->io_activity;
+    sample->excluded_io_activity = sample->io_activity - counted;
+    sample->io_activity = counted;
+
+    if (sample->excluded_cpu_usage > 0 || sample->excluded_io_activity > 0) {
+        daemon_log(LOG_LEVEL_DEBUG, "Not counted (%s): %.2f%% CPU, %.2f KB/s I/O",
+                   allow ? "outside activity_allowlist" : "activity_denylist and the daemon itself",
+                   sample->excluded_cpu_usage, sample->excluded_io_activity);
+    }
+}
+
+/* Reduces one pair of snapshots to per-signal rates and threshold verdicts. */
+static double latest_cpu_usage = 0;
+static double latest_io_kbps = 0;
+static double latest_net_kbps = 0;
+static double latest_cgroup_cpu_usage = 0;
+static double latest_cgroup_io_kbps = 0;
+
+static void evaluate_activity(const struct activity_snapshot *start, const struct activity_snapshot *end,
+                              struct activity_sample *sample) {
+    double seconds = (end->taken.tv_sec - start->taken.tv_sec) + (end->taken.tv_nsec - start->taken.tv_nsec) / 1e9;
+    if (seconds <= 0) seconds = 1;
+
+    memset(sample, 0, sizeof(*sample));
+    sample->window_seconds = seconds;
+
+    if (start->cpu_valid && end->cpu_valid) {
+        evaluate_cpu_policy(&start->cpu, &end->cpu, sample);
+    } else {
+        daemon_log(LOG_LEVEL_ERROR, "Failed to read /proc/stat");
+    }
+
+    if (start->disk_valid && end->disk_valid) {
+        evaluate_disk_activity(&start->disk, &end->disk, seconds, sample);
+        sample->io_activity = sample->read_activity + sample->write_activity;
+    } else {
+        daemon_log(LOG_LEVEL_ERROR, "Failed to read /proc/diskstats");
+    }
+
+    if (start->processes.valid && end->processes.valid && start->cpu_valid && end->cpu_valid) {
+        attribute_activity(start, end, seconds, sample);
+    }
+    sample->cpu_active = sample->cpu_policy_usage > cpu_threshold;
+    sample->io_active = sample->io_activity > io_threshold;
+
+    if (start->net_valid && end->net_valid) {
+        evaluate_net_activity(&start->net, &end->net, seconds, sample);
+        sample->net_active = sample->net_activity > net_threshold;
+    } else {
+        daemon_log(LOG_LEVEL_ERROR, "Failed to read link statistics over rtnetlink");
+    }
+
+    if (start->cgroups_valid && end->cgroups_valid && start->cgroups.generation == end->cgroups.generation) {
+        evaluate_cgroup_activity(&start->cgroups, &end->cgroups, seconds, sample);
+    }
+
+    latest_cpu_usage = sample->cpu_usage;
+    latest_io_kbps = sample->io_activity;
+    latest_net_kbps = sample->net_activity;
+    latest_cgroup_cpu_usage = sample->cgroup_cpu_usage;
+    latest_cgroup_io_kbps = sample->cgroup_io_activity;
+    status_changed = 1;
+}
+
+/*
+ * Snapshots CPU, disk and network counters at both ends of one shared window, so all three
+ * signals describe the same period and a decision costs max(CPU/Net, I/O) seconds, not their sum.
+ * Only used when activity_window is 0; otherwise decisions read the sliding window below.
+ * The first call takes the opening snapshot and returns 0; the event loop keeps running and the
+ * decision comes back at measurement_due_ms for the closing one. A measurement the decision did
+ * not return to in time, or one a reload made incomparable, is started over.
+ */
+static struct activity_snapshot measurement_start;
+static long long measurement_due_ms = 0;
+/* Set by a reload that rebuilt the device tables or the window; the previous snapshot is not comparable. */
+static int sampler_rebase = 0;
+
+static int sample_system_activity(struct activity_sample *sample) {
+    int window = cpu_net_check_interval > io_check_interval ? cpu_net_check_interval : io_check_interval;
+    long long now = monotonic_ms();
+
+    if (measurement_due_ms == 0 || sampler_rebase || now > measurement_due_ms + (long long)window * 1000) {
+        take_activity_snapshot(&measurement_start);
+        measurement_due_ms = now + (long long)window * 1000;
+        sampler_rebase = 0;
+        return 0;
+    }
+    if (now < measurement_due_ms) {
+        return 0;
+    }
+
+    struct activity_snapshot end;
+    take_activity_snapshot(&end);
+    evaluate_activity(&measurement_start, &end, sample);
+    measurement_due_ms = 0;
+    return 1;
+}
+
+/*
+ * Background samples taken every sample_interval seconds feed a ring that keeps running prefix
+ * sums, a monotonic deque per signal for the maximum and a bucket histogram for the 95th
+ * percentile, so every statistic over the last activity_window seconds is answered without
+ * walking the samples. Sampling only runs during the activity_window seconds before a decision
+ * is due, so an active desktop costs no wakeups; a gap in sampling starts a fresh window.
+ */
+enum activity_signal {
+    ACTIVITY_CPU,
+    ACTIVITY_IO,
+    ACTIVITY_NET,
+    ACTIVITY_CGROUP_CPU,
+    ACTIVITY_CGROUP_IO,
+    ACTIVITY_SIGNALS
+};
+
+/* The cgroup signals stay at zero and are left out of the logs while the probe is off. */
+static int activity_signal_enabled(int signal) {
+    return (signal != ACTIVITY_CGROUP_CPU && signal != ACTIVITY_CGROUP_IO) || cgroup_probe_active();
+}
+
+struct activity_window {
+    int length;
+    long long count;
+    double values[ACTIVITY_SIGNALS][ACTIVITY_RING_SLOTS];
+    double value_sums[ACTIVITY_SIGNALS][ACTIVITY_RING_SLOTS];
+    long long busy_sums[ACTIVITY_SIGNALS][ACTIVITY_RING_SLOTS];
+    long long max_deque[ACTIVITY_SIGNALS][ACTIVITY_RING_SLOTS];
+    int max_head[ACTIVITY_SIGNALS];
+    int max_tail[ACTIVITY_SIGNALS];
+    int histogram[ACTIVITY_SIGNALS][ACTIVITY_HISTOGRAM_BUCKETS];
+};
+
+struct activity_statistics {
+    double average;
+    double maximum;
+    double p95;
+    double busy_fraction;
+    int samples;
+};
+
+static struct activity_window activity_window_state;
+static struct activity_snapshot sampler_snapshots[2];
+static int sampler_current = 0;
+static int sampler_primed = 0;
+static long long sampler_last_tick_ms = 0;
+static long long next_decision_ms = 0;
+static double sampler_last_cpu_usage = 0;
+
+/* CPU percentages get one bucket per percent; byte rates get four buckets per power of two. */
+static int activity_bucket(int signal, double value) {
+    if (value < 0) value = 0;
+    if (signal == ACTIVITY_CPU || signal == ACTIVITY_CGROUP_CPU) {
+        return value >= 100 ? 100 : (int)value;
+    }
+    unsigned long long v = (unsigned long long)value;
+    if (v < 4) {
+        return (int)v;
+    }
+    int msb = 63 - __builtin_clzll(v);
+    int bucket = (msb - 1) * 4 + (int)((v >> (msb - 2)) & 3);
+    return bucket < ACTIVITY_HISTOGRAM_BUCKETS ? bucket : ACTIVITY_HISTOGRAM_BUCKETS - 1;
+}
+
+static double activity_bucket_ceiling(int signal, int bucket) {
+    if (signal == ACTIVITY_CPU || signal == ACTIVITY_CGROUP_CPU || bucket < 4) {
+        return bucket + 1;
+    }
+    int msb = bucket / 4 + 1;
+    return (double)((unsigned long long)(5 + bucket % 4) << (msb - 2));
+}
+
+static void reset_activity_window(void) {
+    int length = sample_interval > 0 ? activity_window / sample_interval : 1;
+    if (length < 1) length = 1;
+    if (length > ACTIVITY_RING_SLOTS - 1) length = ACTIVITY_RING_SLOTS - 1;
+
+    memset(&activity_window_state, 0, sizeof(activity_window_state));
+    activity_window_state.length = length;
+}
+
+static void push_activity_window(const double values[ACTIVITY_SIGNALS], const int busy[ACTIVITY_SIGNALS]) {
+    struct activity_window *w = &activity_window_state;
+    long long n = ++w->count;
+    int slot = n % ACTIVITY_RING_SLOTS;
+    int previous = (n - 1) % ACTIVITY_RING_SLOTS;
+
+    for (int s = 0; s < ACTIVITY_SIGNALS; s++) {
+        double value = values[s];
+        w->values[s][slot] = value;
+        w->value_sums[s][slot] = w->value_sums[s][previous] + value;
+        w->busy_sums[s][slot] = w->busy_sums[s][previous] + (busy[s] ? 1 : 0);
+
+        while (w->max_tail[s] != w->max_head[s]) {
+            int back = (w->max_tail[s] + ACTIVITY_RING_SLOTS - 1) % ACTIVITY_RING_SLOTS;
+            if (w->values[s][w->max_deque[s][back] % ACTIVITY_RING_SLOTS] > value) break;
+            w->max_tail[s] = back;
+        }
+        w->max_deque[s][w->max_tail[s]] = n;
+        w->max_tail[s] = (w->max_tail[s] + 1) % ACTIVITY_RING_SLOTS;
+        while (w->max_deque[s][w->max_head[s]] <= n - w->length) {
+            w->max_head[s] = (w->max_head[s] + 1) % ACTIVITY_RING_SLOTS;
+        }
+
+        w->histogram[s][activity_bucket(s, value)]++;
+        if (n > w->length) {
+            w->histogram[s][activity_bucket(s, w->values[s][(n - w->length) % ACTIVITY_RING_SLOTS])]--;
+        }
+    }
+}
+
+static void query_activity_window(int signal, struct activity_statistics *stats) {
+    const struct activity_window *w = &activity_window_state;
+    long long n = w->count;
+    int samples = n < w->length ? (int)n : w->length;
+    int last = n % ACTIVITY_RING_SLOTS;
+    int first = (n - samples) % ACTIVITY_RING_SLOTS;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->samples = samples;
+    if (samples == 0) {
+        return;
+    }
+
+    stats->average = (w->value_sums[signal][last] - w->value_sums[signal][first]) / samples;
+    stats->busy_fraction = (double)(w->busy_sums[signal][last] - w->busy_sums[signal][first]) / samples;
+    stats->maximum = w->values[signal][w->max_deque[signal][w->max_head[signal]] % ACTIVITY_RING_SLOTS];
+
+    int rank = (samples * 95 + 99) / 100;
+    int seen = 0;
+    for (int b = 0; b < ACTIVITY_HISTOGRAM_BUCKETS; b++) {
+        seen += w->histogram[signal][b];
+        if (seen >= rank) {
+            stats->p95 = activity_bucket_ceiling(signal, b);
+            if (stats->p95 > stats->maximum) stats->p95 = stats->maximum;
+            break;
+        }
+    }
+}
+
+/* Records when the next decision is expected, so sampling can start activity_window seconds earlier. */
+void schedule_next_decision(long long delay_ms) {
+    long long at = monotonic_ms() + delay_ms;
+    if (next_decision_ms == 0 || at < next_decision_ms) {
+        next_decision_ms = at;
+    }
+}
+
+static int pressure_source_active(void);
+
+static long long next_sample_due_ms(long long now) {
+    if (activity_window <= 0 || pressure_source_active()) {
+        return LLONG_MAX;
+    }
+    /* One extra interval, because the first snapshot only primes the deltas. */
+    long long start = next_decision_ms - (long long)(activity_window + sample_interval) * 1000;
+    if (now < start) {
+        return start;
+    }
+    /* A decision that did not come (the user got active before the alarm fired) ends sampling too. */
+    if (now > next_decision_ms + (long long)sample_interval * 1000) {
+        return LLONG_MAX;
+    }
+    return sampler_primed ? sampler_last_tick_ms + (long long)sample_interval * 1000 : now;
+}
+
+const char *activity_statistic_name(int statistic) {
+    if (statistic == ACTIVITY_STATISTIC_MAX) return "max";
+    if (statistic == ACTIVITY_STATISTIC_P95) return "p95";
+    return "average";
+}
+
+static double select_activity_statistic(const struct activity_statistics *stats) {
+    if (activity_statistic == ACTIVITY_STATISTIC_MAX) return stats->maximum;
+    if (activity_statistic == ACTIVITY_STATISTIC_P95) return stats->p95;
+    return stats->average;
+}
+
+/*
+ * Each signal is smoothed with an exponentially weighted average and run through a two-state
+ * machine: it turns active above its threshold, turns idle again only below the lower exit
+ * threshold, and either change must hold for min_dwell_time seconds first. Only state changes
+ * are reported, as events queued for whoever consumes them.
+ */
+struct activity_engine_signal {
+    int seeded;
+    int active;
+    double smoothed;
+    long long pending_since_ms;
+    long long changed_ms;
+};
+
+struct activity_event {
+    long long time_ms;
+    int signal;
+    int active;
+    double value;
+};
+
+static const char *activity_signal_names[ACTIVITY_SIGNALS] = {"CPU", "I/O", "Network", "Cgroup CPU", "Cgroup I/O"};
+static struct activity_engine_signal activity_engine[ACTIVITY_SIGNALS];
+static struct activity_event activity_events[ACTIVITY_EVENT_QUEUE];
+static unsigned int activity_event_head = 0;
+static unsigned int activity_event_tail = 0;
+
+static void reset_activity_engine(void) {
+    memset(activity_engine, 0, sizeof(activity_engine));
+}
+
+static void push_activity_event(int signal, int active, double value, long long now) {
+    if (activity_event_tail - activity_event_head == ACTIVITY_EVENT_QUEUE) {
+        activity_event_head++;
+    }
+    struct activity_event *event = &activity_events[activity_event_tail++ % ACTIVITY_EVENT_QUEUE];
+    event->time_ms = now;
+    event->signal = signal;
+    event->active = active;
+    event->value = value;
+}
+
+int pop_activity_event(struct activity_event *event) {
+    if (activity_event_head == activity_event_tail) {
+        return 0;
+    }
+    *event = activity_events[activity_event_head++ % ACTIVITY_EVENT_QUEUE];
+    return 1;
+}
+
+/* Busy fractions only exist for the sliding window; the single-window path feeds raw rates. */
+static void activity_engine_thresholds(int signal, double *enter, double *exit) {
+    if (activity_busy_percent > 0 && activity_window > 0 && !pressure_source_active()) {
+        *enter = *exit = activity_busy_percent;
+        return;
+    }
+    if ((signal == ACTIVITY_CPU || signal == ACTIVITY_IO) && pressure_source_active()) {
+        *enter = *exit = signal == ACTIVITY_CPU ? psi_cpu_threshold : psi_io_threshold;
+        return;
+    }
+    int thresholds[ACTIVITY_SIGNALS][2] = {
+        {cpu_threshold, cpu_exit_threshold},
+        {io_threshold, io_exit_threshold},
+        {net_threshold, net_exit_threshold},
+        {cgroup_cpu_threshold, cgroup_cpu_threshold},
+        {cgroup_io_threshold, cgroup_io_threshold}
+    };
+    *enter = thresholds[signal][0];
+    *exit = thresholds[signal][1] < thresholds[signal][0] ? thresholds[signal][1] : thresholds[signal][0];
+}
+
+static void update_activity_engine(int signal, double value, long long now) {
+    struct activity_engine_signal *engine = &activity_engine[signal];
+    double enter, exit;
+    activity_engine_thresholds(signal, &enter, &exit);
+
+    if (!engine->seeded) {
+        engine->seeded = 1;
+        engine->smoothed = value;
+        engine->active = value > enter;
+        engine->changed_ms = now;
+        engine->pending_since_ms = 0;
+        if (engine->active) {
+            push_activity_event(signal, 1, value, now);
+        }
+        return;
+    }
+
+    engine->smoothed += (value - engine->smoothed) * ewma_weight / 100.0;
+    int wanted = engine->active ? engine->smoothed >= exit : engine->smoothed > enter;
+    if (wanted == engine->active) {
+        engine->pending_since_ms = 0;
+        return;
+    }
+    if (engine->pending_since_ms == 0) {
+        engine->pending_since_ms = now;
+    }
+    if (now - engine->pending_since_ms >= (long long)min_dwell_time * 1000) {
+        engine->active = wanted;
+        engine->changed_ms = now;
+        engine->pending_since_ms = 0;
+        push_activity_event(signal, wanted, engine->smoothed, now);
+    }
+}
+
+static void feed_activity_engine_from_window(long long now) {
+    for (int s = 0; s < ACTIVITY_SIGNALS; s++) {
+        struct activity_statistics stats;
+        query_activity_window(s, &stats);
+        update_activity_engine(s, activity_busy_percent > 0 ? stats.busy_fraction * 100 : select_activity_statistic(&stats), now);
+    }
+}
+
+static void drain_activity_events(void) {
+    struct activity_event event;
+    while (pop_activity_event(&event)) {
+        daemon_log(LOG_LEVEL_INFO, "%s became %s (smoothed %.2f)", activity_signal_names[event.signal],
+                   event.active ? "active" : "idle", event.value);
+        status_changed = 1;
+    }
+}
+
+static void activity_sampler_tick(void) {
+    long long now = monotonic_ms();
+    struct activity_snapshot *previous = &sampler_snapshots[sampler_current];
+    struct activity_snapshot *current = &sampler_snapshots[!sampler_current];
+
+    take_activity_snapshot(current);
+    if (!sampler_primed || now - sampler_last_tick_ms > (long long)sample_interval * 2000) {
+        /*
+         * Sampling pauses between decision windows. The smoothed values and states carry over so
+         * hysteresis spans decisions; only a pending change restarts its dwell, as nothing was
+         * seen in the gap.
+         */
+        reset_activity_window();
+        for (int s = 0; s < ACTIVITY_SIGNALS; s++) {
+            activity_engine[s].pending_since_ms = 0;
+        }
+    } else if (sampler_rebase) {
+        /* A reload rebuilt the device tables or the window, so the previous snapshot is not comparable. */
+    } else {
+        struct activity_sample sample;
+        evaluate_activity(previous, current, &sample);
+        double values[ACTIVITY_SIGNALS] = {sample.cpu_policy_usage, sample.io_activity, sample.net_activity,
+                                           sample.cgroup_cpu_usage, sample.cgroup_io_activity};
+        int busy[ACTIVITY_SIGNALS] = {sample.cpu_active, sample.io_active, sample.net_active,
+                                      sample.cgroup_cpu_active, sample.cgroup_io_active};
+        push_activity_window(values, busy);
+        feed_activity_engine_from_window(now);
+        sampler_last_cpu_usage = sample.cpu_usage;
+    }
+
+    sampler_current = !sampler_current;
+    sampler_primed = 1;
+    sampler_rebase = 0;
+    sampler_last_tick_ms = now;
+}
+
+/*
+ * Pressure stall information. With activity_source=1 the CPU and I/O verdicts come from the
+ * "some" line of /proc/pressure/{cpu,io,memory}, whose 10, 60 and 300 second averages the kernel
+ * keeps up to date, so a decision costs one pread() per file and nothing is sampled in between.
+ * A memory stall (reclaim, swap-in) counts as I/O pressure. Without PSI (CONFIG_PSI off or
+ * psi=0 on the kernel command line) the counters are used as before.
+ */
+enum pressure_resource {
+    PRESSURE_CPU,
+    PRESSURE_IO,
+    PRESSURE_MEMORY,
+    PRESSURE_RESOURCES
+};
+
+static const char *pressure_names[PRESSURE_RESOURCES] = {"cpu", "io", "memory"};
+static int pressure_fds[PRESSURE_RESOURCES] = {-1, -1, -1};
+static double latest_pressure[PRESSURE_RESOURCES];
+
+static void close_pressure_files(void) {
+    for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+        if (pressure_fds[i] != -1) {
+            close(pressure_fds[i]);
+            pressure_fds[i] = -1;
+        }
+    }
+}
+
+/* Called at startup and when a reload changes activity_source. */
+static void open_pressure_files(void) {
+    close_pressure_files();
+    if (activity_source != ACTIVITY_SOURCE_PSI) {
+        return;
+    }
+    for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/proc/pressure/%s", pressure_names[i]);
+        pressure_fds[i] = open(path, O_RDONLY | O_CLOEXEC);
+        if (pressure_fds[i] == -1) {
+            daemon_log(LOG_LEVEL_WARNING, "Pressure stall information is not available (%s: %s), using the CPU and I/O counters",
+                       path, strerror(errno));
+            close_pressure_files();
+            return;
+        }
+    }
+}
+
+static int pressure_source_active(void) {
+    return activity_source == ACTIVITY_SOURCE_PSI && pressure_fds[PRESSURE_CPU] != -1;
+}
+
+/* Reads the psi_average second average of the "some" line, in percent of wall time. */
+static int read_pressure(int resource, double *value) {
+    char buffer[256];
+    ssize_t len = pread(pressure_fds[resource], buffer, sizeof(buffer) - 1, 0);
+    if (len <= 0) {
+        return 0;
+    }
+    buffer[len] = '\0';
+    char key[16];
+    snprintf(key, sizeof(key), " avg%d=", psi_average);
+    char *some = strstr(buffer, "some");
+    char *average = some != NULL ? strstr(some, key) : NULL;
+    if (average == NULL) {
+        return 0;
+    }
+    *value = strtod(average + strlen(key), NULL);
+    return 1;
+}
+
+/*
+ * Network and cgroup figures cannot come from PSI, so they are measured between the snapshot
+ * taken at the previous decision and this one instead of across a sleep.
+ */
+static struct activity_snapshot pressure_snapshots[2];
+static int pressure_current = 0;
+static int pressure_primed = 0;
+
+static void pressure_system_activity(struct activity_sample *sample) {
+    struct activity_snapshot *previous = &pressure_snapshots[pressure_current];
+    struct activity_snapshot *current = &pressure_snapshots[!pressure_current];
+
+    take_activity_snapshot(current);
+    evaluate_activity(pressure_primed && !sampler_rebase ? previous : current, current, sample);
+    pressure_current = !pressure_current;
+    pressure_primed = 1;
+    sampler_rebase = 0;
+
+    for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+        if (!read_pressure(i, &latest_pressure[i])) {
+            daemon_log(LOG_LEVEL_ERROR, "Failed to read /proc/pressure/%s", pressure_names[i]);
+            latest_pressure[i] = 0;
+        }
+    }
+    sample->cpu_pressure = latest_pressure[PRESSURE_CPU];
+    sample->io_pressure = latest_pressure[PRESSURE_IO] > latest_pressure[PRESSURE_MEMORY] ?
+                          latest_pressure[PRESSURE_IO] : latest_pressure[PRESSURE_MEMORY];
+    sample->cpu_active = sample->cpu_pressure > psi_cpu_threshold;
+    sample->io_active = sample->io_pressure > psi_io_threshold;
+}
+
+static void log_window_signal(const char *name, const char *unit, const struct activity_statistics *stats,
+                              int threshold, int active) {
+    daemon_log(LOG_LEVEL_DEBUG, "%s over %d samples: average %.2f%s, max %.2f%s, p95 %.2f%s, above threshold %.0f%% of the time (threshold: %d%s)%s",
+               name, stats->samples, stats->average, unit, stats->maximum, unit, stats->p95, unit,
+               stats->busy_fraction * 100, threshold, unit, active ? " - high activity detected" : "");
+}
+
+/*
+ * Answers from the window. While it is still empty the snapshot that primes it is taken and 0
+ * is returned; the event loop runs the decision again after the sample timer has filled it.
+ */
+static int decision_waits_for_sample = 0;
+
+static int window_system_activity(struct activity_sample *sample) {
+    if (activity_window_state.count == 0) {
+        daemon_log(LOG_LEVEL_DEBUG, "Activity window is empty, deciding after the next sample");
+        if (!sampler_primed || monotonic_ms() - sampler_last_tick_ms > (long long)sample_interval * 2000) {
+            activity_sampler_tick();
+        }
+        decision_waits_for_sample = 1;
+        return 0;
+    }
+
+    struct activity_statistics cpu, io, net, cgroup_cpu, cgroup_io;
+    query_activity_window(ACTIVITY_CPU, &cpu);
+    query_activity_window(ACTIVITY_IO, &io);
+    query_activity_window(ACTIVITY_NET, &net);
+    query_activity_window(ACTIVITY_CGROUP_CPU, &cgroup_cpu);
+    query_activity_window(ACTIVITY_CGROUP_IO, &cgroup_io);
+
+    memset(sample, 0, sizeof(*sample));
+    sample->cpu_usage = sampler_last_cpu_usage;
+    sample->cpu_policy_usage = select_activity_statistic(&cpu);
+    sample->io_activity = select_activity_statistic(&io);
+    sample->net_activity = select_activity_statistic(&net);
+    sample->cpu_active = activity_engine[ACTIVITY_CPU].active;
+    sample->io_active = activity_engine[ACTIVITY_IO].active;
+    sample->net_active = activity_engine[ACTIVITY_NET].active;
+    sample->cgroup_cpu_usage = select_activity_statistic(&cgroup_cpu);
+    sample->cgroup_io_activity = select_activity_statistic(&cgroup_io);
+    sample->cgroup_cpu_active = activity_engine[ACTIVITY_CGROUP_CPU].active;
+    sample->cgroup_io_active = activity_engine[ACTIVITY_CGROUP_IO].active;
+    sample->window_seconds = (double)cpu.samples * sample_interval;
+
+    log_window_signal("CPU usage", "%", &cpu, cpu_threshold, sample->cpu_active);
+    log_window_signal("I/O activity", " KB/s", &io, io_threshold, sample->io_active);
+    log_window_signal("Network activity", " KB/s", &net, net_threshold, sample->net_active);
+    if (cgroup_probe_active()) {
+        log_window_signal("Cgroup CPU usage", "%", &cgroup_cpu, cgroup_cpu_threshold, sample->cgroup_cpu_active);
+        log_window_signal("Cgroup I/O activity", " KB/s", &cgroup_io, cgroup_io_threshold, sample->cgroup_io_active);
+    }
+    return 1;
+}
+
+static void log_top_process(const struct activity_sample *sample);
+
+/* Returns 1 for activity, 0 for none and ACTIVITY_CHECK_PENDING while the data is still being collected. */
+int check_system_activity(void) {
+    struct activity_sample sample;
+
+    daemon_log(LOG_LEVEL_DEBUG, "Checking system activity");
+    if (activity_window > 0 && !pressure_source_active()) {
+        if (!window_system_activity(&sample)) {
+            return ACTIVITY_CHECK_PENDING;
+        }
+    } else {
+        int pressure = pressure_source_active();
+        if (pressure) {
+            pressure_system_activity(&sample);
+        } else if (!sample_system_activity(&sample)) {
+            return ACTIVITY_CHECK_PENDING;
+        }
+        long long now = monotonic_ms();
+        update_activity_engine(ACTIVITY_CPU, pressure ? sample.cpu_pressure : sample.cpu_policy_usage, now);
+        update_activity_engine(ACTIVITY_IO, pressure ? sample.io_pressure : sample.io_activity, now);
+        update_activity_engine(ACTIVITY_NET, sample.net_activity, now);
+        update_activity_engine(ACTIVITY_CGROUP_CPU, sample.cgroup_cpu_usage, now);
+        update_activity_engine(ACTIVITY_CGROUP_IO, sample.cgroup_io_activity, now);
+        sample.cpu_active = activity_engine[ACTIVITY_CPU].active;
+        sample.io_active = activity_engine[ACTIVITY_IO].active;
+        sample.net_active = activity_engine[ACTIVITY_NET].active;
+        sample.cgroup_cpu_active = activity_engine[ACTIVITY_CGROUP_CPU].active;
+        sample.cgroup_io_active = activity_engine[ACTIVITY_CGROUP_IO].active;
+        if (pressure) {
+            daemon_log(LOG_LEVEL_DEBUG, "CPU pressure: %.2f%% over %d seconds (threshold: %d%%)%s", latest_pressure[PRESSURE_CPU],
+                       psi_average, psi_cpu_threshold, sample.cpu_active ? " - high CPU activity detected" : "");
+            daemon_log(LOG_LEVEL_DEBUG, "I/O pressure: %.2f%%, memory pressure: %.2f%% over %d seconds (threshold: %d%%)%s",
+                       latest_pressure[PRESSURE_IO], latest_pressure[PRESSURE_MEMORY], psi_average, psi_io_threshold,
+                       sample.io_active ? " - high I/O activity detected" : "");
+        } else {
+            daemon_log(LOG_LEVEL_DEBUG, "CPU usage: %.2f%% aggregate, busiest core cpu%d at %.2f%%, %s: %.2f%% (threshold: %d%%)%s",
+                       sample.cpu_usage, sample.cpu_busiest_core,
+                       sample.cpu_busiest_core >= 0 ? sample.cpu_core_usage[sample.cpu_busiest_core] : 0.0,
+                       cpu_policy_name(cpu_policy), sample.cpu_policy_usage, cpu_threshold,
+                       sample.cpu_active ? " - high CPU activity detected" : "");
+            daemon_log(LOG_LEVEL_DEBUG, "I/O activity: %.2f KB/s (read %.2f KB/s, write %.2f KB/s, busiest device %s, threshold: %d KB/s)%s",
+                       sample.io_activity, sample.read_activity, sample.write_activity,
+                       sample.io_busiest_device >= 0 ? disk_devices[sample.io_busiest_device].name : "none", io_threshold,
+                       sample.io_active ? " - high I/O activity detected" : "");
+        }
+        daemon_log(LOG_LEVEL_DEBUG, "Network activity: %.1f KB/s (busiest interface %s, threshold: %d KB/s)%s", sample.net_activity,
+                   sample.net_busiest_interface[0] ? sample.net_busiest_interface : "none", net_threshold,
+                   sample.net_active ? " - high network activity detected" : "");
+        if (cgroup_probe_active()) {
+            daemon_log(LOG_LEVEL_DEBUG, "Cgroup activity: %.2f%% CPU (threshold: %d%%), %.2f KB/s I/O (threshold: %d KB/s)%s",
+                       sample.cgroup_cpu_usage, cgroup_cpu_threshold, sample.cgroup_io_activity, cgroup_io_threshold,
+                       sample.cgroup_cpu_active || sample.cgroup_io_active ? " - high cgroup activity detected" : "");
+        }
+    }
+
+    drain_activity_events();
+    for (int s = 0; s < ACTIVITY_SIGNALS; s++) {
+        if (!activity_signal_enabled(s)) {
+            continue;
+        }
+        double enter, exit;
+        activity_engine_thresholds(s, &enter, &exit);
+        daemon_log(LOG_LEVEL_DEBUG, "%s is %s for %.0f seconds (smoothed %.2f, enter above %.0f, leave below %.0f)",
+                   activity_signal_names[s], activity_engine[s].active ? "active" : "idle",
+                   (monotonic_ms() - activity_engine[s].changed_ms) / 1000.0, activity_engine[s].smoothed, enter, exit);
+    }
+
+    iteration_record.flags |= SAMPLE_FLAG_SAMPLED |
+                              (sample.cpu_active ? SAMPLE_FLAG_CPU_ACTIVE : 0) |
+                              (sample.io_active ? SAMPLE_FLAG_IO_ACTIVE : 0) |
+                              (sample.net_active ? SAMPLE_FLAG_NET_ACTIVE : 0);
+    iteration_record.cpu_usage = sample.cpu_usage;
+    iteration_record.cpu_policy_usage = sample.cpu_policy_usage;
+    iteration_record.io_kbps = sample.io_activity;
+    iteration_record.net_kbps = sample.net_activity;
+    if (pressure_source_active()) {
+        iteration_record.flags |= SAMPLE_FLAG_PRESSURE;
+        iteration_record.cpu_pressure = latest_pressure[PRESSURE_CPU];
+        iteration_record.io_pressure = latest_pressure[PRESSURE_IO];
+        iteration_record.memory_pressure = latest_pressure[PRESSURE_MEMORY];
+    }
+
+    if (sample.cpu_active || sample.io_active || sample.net_active || sample.cgroup_cpu_active || sample.cgroup_io_active) {
+        daemon_log(LOG_LEVEL_DEBUG, "System activity detected over %.1f seconds (cpu=%d io=%d net=%d cgroup_cpu=%d cgroup_io=%d)",
+                   sample.window_seconds, sample.cpu_active, sample.io_active, sample.net_active,
+                   sample.cgroup_cpu_active, sample.cgroup_io_active);
+        log_top_process(&sample);
+        return 1;
+    }
+    log_top_process(NULL);
+
+    daemon_log(LOG_LEVEL_DEBUG, "No significant system activity detected over %.1f seconds", sample.window_seconds);
+    return 0;
+}
+
+/*
+ * custom_long_running_apps is a '|'-separated list compiled once into a matcher. Each entry is
+ * an exact comm name, a "name*" prefix, a glob, or "re:" followed by an extended regex tested
+ * against the full command line ("\|" is a literal '|' inside an entry). Exact names are kept
+ * sorted for a binary search; comm is truncated by the kernel, so names are truncated to match.
+ */
+enum app_pattern_type {
+    APP_PATTERN_PREFIX,
+    APP_PATTERN_GLOB,
+    APP_PATTERN_REGEX
+};
+
+struct app_pattern {
+    enum app_pattern_type type;
+    char text[MAX_COMMAND_LENGTH];
+    regex_t regex;
+};
+
+struct app_matcher {
+    char exact[MAX_APP_PATTERNS][TASK_COMM_LENGTH];
+    int exact_count;
+    struct app_pattern patterns[MAX_APP_PATTERNS];
+    int pattern_count;
+    int regex_count;
+};
+
+static int compare_comm_names(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+void free_app_matcher(struct app_matcher *matcher) {
+    for (int i = 0; i < matcher->pattern_count; i++) {
+        if (matcher->patterns[i].type == APP_PATTERN_REGEX) {
+            regfree(&matcher->patterns[i].regex);
+        }
+    }
+    matcher->exact_count = 0;
+    matcher->pattern_count = 0;
+    matcher->regex_count = 0;
+}
+
+static int add_app_pattern(struct app_matcher *matcher, const char *entry, char *error, size_t error_size) {
+    if (entry[0] == '\0') {
+        return 1;
+    }
+    if (matcher->exact_count + matcher->pattern_count >= MAX_APP_PATTERNS) {
+        snprintf(error, error_size, "Too many long-running app entries (at most %d)", MAX_APP_PATTERNS);
+        return 0;
+    }
+
+    if (strncmp(entry, "re:", 3) == 0) {
+        struct app_pattern *pattern = &matcher->patterns[matcher->pattern_count];
+        int rc = regcomp(&pattern->regex, entry + 3, REG_EXTENDED | REG_NOSUB);
+        if (rc != 0) {
+            char reason[128];
+            regerror(rc, &pattern->regex, reason, sizeof(reason));
+            snprintf(error, error_size, "Invalid regular expression '%s': %s", entry + 3, reason);
+            return 0;
+        }
+        pattern->type = APP_PATTERN_REGEX;
+        snprintf(pattern->text, sizeof(pattern->text), "%s", entry + 3);
+        matcher->pattern_count++;
+        matcher->regex_count++;
+        return 1;
+    }
+
+    size_t len = strlen(entry);
+    const char *wildcard = strpbrk(entry, "*?[");
+    if (wildcard == NULL) {
+        snprintf(matcher->exact[matcher->exact_count++], TASK_COMM_LENGTH, "%s", entry);
+    } else if (wildcard == entry + len - 1 && *wildcard == '*') {
+        struct app_pattern *pattern = &matcher->patterns[matcher->pattern_count++];
+        pattern->type = APP_PATTERN_PREFIX;
+        snprintf(pattern->text, sizeof(pattern->text), "%.*s", (int)(len - 1 < TASK_COMM_LENGTH - 1 ? len - 1 : TASK_COMM_LENGTH - 1), entry);
+    } else {
+        struct app_pattern *pattern = &matcher->patterns[matcher->pattern_count++];
+        pattern->type = APP_PATTERN_GLOB;
+        snprintf(pattern->text, sizeof(pattern->text), "%s", entry);
+    }
+    return 1;
+}
+
+/* Returns 0 and fills error when an entry is invalid; the matcher is then left empty. */
+int compile_app_matcher(struct app_matcher *matcher, const char *list, char *error, size_t error_size) {
+    memset(matcher, 0, sizeof(*matcher));
+
+    char entry[MAX_COMMAND_LENGTH];
+    size_t len = 0;
+    for (const char *p = list;; p++) {
+        if (*p == '\\' && p[1] == '|') {
+            if (len < sizeof(entry) - 1) entry[len++] = '|';
+            p++;
+            continue;
+        }
+        if (*p == '|' || *p == '\0') {
+            while (len > 0 && isspace((unsigned char)entry[len - 1])) len--;
+            entry[len] = '\0';
+            const char *start = entry;
+            while (isspace((unsigned char)*start)) start++;
+            if (!add_app_pattern(matcher, start, error, error_size)) {
+                free_app_matcher(matcher);
+                return 0;
+            }
+            len = 0;
+            if (*p == '\0') {
+                break;
+            }
+            continue;
+        }
+        if (len < sizeof(entry) - 1) entry[len++] = *p;
+    }
+
+    qsort(matcher->exact, matcher->exact_count, TASK_COMM_LENGTH, compare_comm_names);
+    return 1;
+}
+
+static int read_process_cmdline(pid_t pid, char *buffer, size_t size) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/cmdline", (int)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    ssize_t len = read(fd, buffer, size - 1);
+    close(fd);
+    if (len <= 0) {
+        return 0;
+    }
+    while (len > 0 && buffer[len - 1] == '\0') len--;
+    for (ssize_t i = 0; i < len; i++) {
+        if (buffer[i] == '\0') buffer[i] = ' ';
+    }
+    buffer[len] = '\0';
+    return 1;
+}
+
+/* The command line is only read when comm matched nothing and a regex entry exists. */
+int app_matcher_matches(const struct app_matcher *matcher, pid_t pid, const char *comm) {
+    if (matcher->exact_count > 0 &&
+        bsearch(comm, matcher->exact, matcher->exact_count, TASK_COMM_LENGTH, compare_comm_names) != NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < matcher->pattern_count; i++) {
+        const struct app_pattern *pattern = &matcher->patterns[i];
+        if (pattern->type == APP_PATTERN_PREFIX && strncmp(comm, pattern->text, strlen(pattern->text)) == 0) {
+            return 1;
+        }
+        if (pattern->type == APP_PATTERN_GLOB && fnmatch(pattern->text, comm, 0) == 0) {
+            return 1;
+        }
+    }
+
+    if (matcher->regex_count == 0) {
+        return 0;
+    }
+
+    char cmdline[PROCESS_CMDLINE_SIZE];
+    if (!read_process_cmdline(pid, cmdline, sizeof(cmdline))) {
+        return 0;
+    }
+    for (int i = 0; i < matcher->pattern_count; i++) {
+        if (matcher->patterns[i].type == APP_PATTERN_REGEX &&
+            regexec(&matcher->patterns[i].regex, cmdline, 0, NULL, 0) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Matching processes (thread group leaders only) are kept in an open-addressed pid set that the
+ * proc connector updates on fork, exec, comm change and exit, so the per-iteration question is a
+ * counter check. The connector is drained from the event loop as events arrive, so its queue
+ * does not have to hold a whole check interval. Without the connector (it needs CAP_NET_ADMIN)
+ * /proc is rescanned on each query.
+ */
+static struct app_matcher long_running_apps_matcher;
+static int long_running_apps_matcher_valid = 0;
+static pid_t long_running_pids[MAX_TRACKED_PROCESSES];
+static int long_running_count = 0;
+static int proc_connector_fd = -1;
+static int proc_tracker_seeded = 0;
+static char proc_connector_buffer[PROC_CONNECTOR_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+#define PID_SLOT_DELETED (-1)
+
+static int find_tracked_pid_slot(pid_t pid, int for_insert) {
+    int free_slot = -1;
+    for (int probe = 0; probe < MAX_TRACKED_PROCESSES; probe++) {
+        int slot = (pid + probe) % MAX_TRACKED_PROCESSES;
+        if (long_running_pids[slot] == pid) {
+            return slot;
+        }
+        if (long_running_pids[slot] == PID_SLOT_DELETED) {
+            if (free_slot < 0) free_slot = slot;
+        } else if (long_running_pids[slot] == 0) {
+            return for_insert ? (free_slot >= 0 ? free_slot : slot) : -1;
+        }
+    }
+    return for_insert ? free_slot : -1;
+}
+
+static void track_process(pid_t pid, int matches) {
+    if (pid <= 0 || pid == getpid()) {
+        return;
+    }
+    int slot = find_tracked_pid_slot(pid, matches);
+    if (slot < 0) {
+        return;
+    }
+    if (matches && long_running_pids[slot] != pid) {
+        long_running_pids[slot] = pid;
+        long_running_count++;
+    } else if (!matches && long_running_pids[slot] == pid) {
+        long_running_pids[slot] = PID_SLOT_DELETED;
+        long_running_count--;
+    }
+}
+
+static int comm_matches_long_running_apps(pid_t pid, const char *comm) {
+    return long_running_apps_matcher_valid && app_matcher_matches(&long_running_apps_matcher, pid, comm);
+}
+
+static int read_process_comm(pid_t pid, char *comm, size_t size) {
+    char comm_path[64];
+    snprintf(comm_path, sizeof(comm_path), "/proc/%d/comm", (int)pid);
+    int fd = open(comm_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+
+    ssize_t len = read(fd, comm, size - 1);
+    close(fd);
+    if (len <= 0) {
+        return 0;
+    }
+    comm[len] = '\0';
+    comm[strcspn(comm, "\n")] = '\0';
+    return 1;
+}
+
+static int process_matches_long_running_apps(pid_t pid) {
+    char comm[32];
+    return read_process_comm(pid, comm, sizeof(comm)) && comm_matches_long_running_apps(pid, comm);
+}
+
+/* Names one tracked long-running process for the status display. */
+static int find_matched_long_running_app(char *comm, size_t size) {
+    for (int slot = 0; slot < MAX_TRACKED_PROCESSES && long_running_count > 0; slot++) {
+        if (long_running_pids[slot] > 0 && read_process_comm(long_running_pids[slot], comm, size)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void rescan_long_running_apps(void) {
+    memset(long_running_pids, 0, sizeof(long_running_pids));
+    long_running_count = 0;
+
+    DIR *proc = opendir("/proc");
+    if (proc == NULL) {
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(proc)) != NULL) {
+        if (!isdigit((unsigned char)entry->d_name[0])) {
+            continue;
+        }
+        pid_t pid = atoi(entry->d_name);
+        if (process_matches_long_running_apps(pid)) {
+            track_process(pid, 1);
+        }
+    }
+    closedir(proc);
+    proc_tracker_seeded = 1;
+}
+
+static int send_proc_connector_op(enum proc_cn_mcast_op op) {
+    struct {
+        struct nlmsghdr header;
+        struct cn_msg message;
+        enum proc_cn_mcast_op op;
+    } __attribute__((packed)) request = {0};
+
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = NLMSG_DONE;
+    request.header.nlmsg_pid = getpid();
+    request.message.id.idx = CN_IDX_PROC;
+    request.message.id.val = CN_VAL_PROC;
+    request.message.len = sizeof(enum proc_cn_mcast_op);
+    request.op = op;
+    return send(proc_connector_fd, &request, sizeof(request), 0) == (ssize_t)sizeof(request);
+}
+
+/* Subscribes to process events and waits briefly for the kernel's acknowledgement. */
+static int open_proc_connector(void) {
+    proc_connector_fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (proc_connector_fd == -1) {
+        return 0;
+    }
+
+    struct sockaddr_nl address = {0};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    address.nl_pid = getpid();
+
+    if (bind(proc_connector_fd, (struct sockaddr *)&address, sizeof(address)) == -1 ||
+        !send_proc_connector_op(PROC_CN_MCAST_LISTEN)) {
+        close(proc_connector_fd);
+        proc_connector_fd = -1;
+        return 0;
+    }
+
+    struct pollfd pfd = {proc_connector_fd, POLLIN, 0};
+    while (poll(&pfd, 1, 250) > 0) {
+        ssize_t len = recv(proc_connector_fd, proc_connector_buffer, sizeof(proc_connector_buffer), 0);
+        if (len <= 0) {
+            break;
+        }
+        for (struct nlmsghdr *header = (struct nlmsghdr *)proc_connector_buffer; NLMSG_OK(header, len); header = NLMSG_NEXT(header, len)) {
+            struct cn_msg *message = NLMSG_DATA(header);
+            struct proc_event *event = (struct proc_event *)message->data;
+            if (message->id.idx == CN_IDX_PROC && event->what == PROC_EVENT_NONE) {
+                if (event->event_data.ack.err == 0) {
+                    /* Room for bursts; the force variant works because the connector needs CAP_NET_ADMIN anyway. */
+                    int size = PROC_CONNECTOR_RCVBUF;
+                    if (setsockopt(proc_connector_fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) == -1) {
+                        setsockopt(proc_connector_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+                    }
+                    return 1;
+                }
+                goto failed;
+            }
+        }
+    }
+
+failed:
+    close(proc_connector_fd);
+    proc_connector_fd = -1;
+    return 0;
+}
+
+static void handle_proc_event(const struct proc_event *event) {
+    switch (event->what) {
+    case PROC_EVENT_FORK:
+        if (event->event_data.fork.child_pid == event->event_data.fork.child_tgid &&
+            find_tracked_pid_slot(event->event_data.fork.parent_tgid, 0) >= 0) {
+            track_process(event->event_data.fork.child_tgid, 1);
+        }
+        break;
+    case PROC_EVENT_EXEC:
+        track_process(event->event_data.exec.process_tgid,
+                      process_matches_long_running_apps(event->event_data.exec.process_tgid));
+        break;
+    case PROC_EVENT_COMM:
+        if (event->event_data.comm.process_pid == event->event_data.comm.process_tgid) {
+            char comm[sizeof(event->event_data.comm.comm) + 1];
+            memcpy(comm, event->event_data.comm.comm, sizeof(event->event_data.comm.comm));
+            comm[sizeof(comm) - 1] = '\0';
+            track_process(event->event_data.comm.process_tgid, comm_matches_long_running_apps(event->event_data.comm.process_tgid, comm));
+        }
+        break;
+    case PROC_EVENT_EXIT:
+        if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid) {
+            track_process(event->event_data.exit.process_tgid, 0);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Applies queued events. If the socket overflowed, events were lost: the rest of the queue is
+ * read and discarded (a queued fork could re-add a child whose exit was dropped) and /proc is
+ * rescanned once it is empty.
+ */
+static void drain_proc_connector(void) {
+    int overflowed = 0;
+    for (;;) {
+        ssize_t len = recv(proc_connector_fd, proc_connector_buffer, sizeof(proc_connector_buffer), 0);
+        if (len == -1 && errno == EINTR) {
+            continue;
+        }
+        if (len == -1 && errno == ENOBUFS) {
+            overflowed = 1;
+            continue;
+        }
+        if (len <= 0) {
+            break;
+        }
+        if (overflowed) {
+            continue;
+        }
+        for (struct nlmsghdr *header = (struct nlmsghdr *)proc_connector_buffer; NLMSG_OK(header, len); header = NLMSG_NEXT(header, len)) {
+            struct cn_msg *message = NLMSG_DATA(header);
+            if (message->id.idx == CN_IDX_PROC && message->id.val == CN_VAL_PROC) {
+                handle_proc_event((const struct proc_event *)message->data);
+            }
+        }
+    }
+    if (overflowed) {
+        daemon_log(LOG_LEVEL_WARNING, "Process event queue overflowed, rescanning /proc");
+        rescan_long_running_apps();
+    }
+}
+
+void init_process_tracker(void) {
+    if (!long_running_apps_matcher_valid) {
+        return;
+    }
+    if (open_proc_connector()) {
+        daemon_log(LOG_LEVEL_INFO, "Tracking long-running apps through the proc connector");
+    } else {
+        daemon_log(LOG_LEVEL_WARNING, "Proc connector unavailable, long-running apps will be found by scanning /proc");
+    }
+    rescan_long_running_apps();
+}
+
+void close_process_tracker(void) {
+    if (proc_connector_fd != -1) {
+        send_proc_connector_op(PROC_CN_MCAST_IGNORE);
+        close(proc_connector_fd);
+        proc_connector_fd = -1;
+    }
+    proc_tracker_seeded = 0;
+}
+
+int check_long_running_apps_active(void) {
+    if (!long_running_apps_matcher_valid) {
+        return 0;
+    }
+
+    if (proc_connector_fd != -1 && proc_tracker_seeded) {
+        drain_proc_connector();
+    } else {
+        rescan_long_running_apps();
+    }
+    return long_running_count > 0;
+}
+
+/*
+ * Per-process attribution. While activity_denylist or activity_allowlist is set, activity
+ * snapshots add the CPU ticks (/proc/<pid>/stat) and storage bytes (/proc/<pid>/io, readable for
+ * the user's own processes only) used since a process was last read to running per-class totals.
+ * Processes that used CPU keep their stat and io files open, and most snapshots only re-read
+ * those with pread(). Every PROCESS_FULL_SCAN_INTERVAL snapshots /proc is walked to find new
+ * processes and catch up the rest; /proc lists pids in ascending order, so each walk is merged
+ * with the sorted table of the previous one.
+ */
+#define MAX_ATTRIBUTED_PROCESSES 4096
+#define MAX_CACHED_PROCESS_FILES 128
+#define PROCESS_FULL_SCAN_INTERVAL 8
+
+enum process_class {
+    PROCESS_COUNTED,
+    PROCESS_DENIED,
+    PROCESS_ALLOWED
+};
+
+struct attributed_process {
+    pid_t pid;
+    int process_class;
+    int stat_fd;
+    int io_fd;
+    int io_state;
+    unsigned long long start_time;
+    unsigned long long ticks;
+    unsigned long long io_bytes;
+    unsigned long long window_ticks;
+    unsigned long long window_io_bytes;
+    char comm[TASK_COMM_LENGTH];
+};
+
+enum process_io_state {
+    PROCESS_IO_UNKNOWN,
+    PROCESS_IO_KNOWN,
+    PROCESS_IO_UNREADABLE
+};
+
+static struct app_matcher activity_denylist_matcher;
+static struct app_matcher activity_allowlist_matcher;
+static struct attributed_process attributed_processes[2][MAX_ATTRIBUTED_PROCESSES];
+static int attributed_counts[2];
+static int attributed_current = 0;
+static int attributed_cached_files = 0;
+static int attributed_classes_stale = 0;
+static struct process_totals attributed_totals;
+static DIR *attribution_proc_dir = NULL;
+static unsigned long long attribution_scan_ticks = 0;
+static int attribution_cached_scans_left = 0;
+static long long attribution_window_started_ms = 0;
+static char top_process_comm[TASK_COMM_LENGTH] = "";
+static pid_t top_process_pid = 0;
+
+static int app_matcher_empty(const struct app_matcher *matcher) {
+    return matcher->exact_count + matcher->pattern_count == 0;
+}
+
+static int activity_allowlist_active(void) {
+    return !app_matcher_empty(&activity_allowlist_matcher);
+}
+
+static int process_attribution_active(void) {
+    return activity_allowlist_active() || !app_matcher_empty(&activity_denylist_matcher);
+}
+
+/* Both lists or neither are replaced; on error the running ones are kept. */
+static int compile_activity_lists(char *error, size_t error_size) {
+    struct app_matcher denylist, allowlist;
+    char reason[MAX_ERROR_LENGTH];
+    if (!compile_app_matcher(&denylist, activity_denylist, reason, sizeof(reason))) {
+        snprintf(error, error_size, "activity_denylist: %s", reason);
+        return 0;
+    }
+    if (!compile_app_matcher(&allowlist, activity_allowlist, reason, sizeof(reason))) {
+        free_app_matcher(&denylist);
+        snprintf(error, error_size, "activity_allowlist: %s", reason);
+        return 0;
+    }
+    free_app_matcher(&activity_denylist_matcher);
+    free_app_matcher(&activity_allowlist_matcher);
+    activity_denylist_matcher = denylist;
+    activity_allowlist_matcher = allowlist;
+    attributed_classes_stale = 1;
+    return 1;
+}
+
+static int classify_process(pid_t pid, const char *comm) {
+    if (pid == getpid() || app_matcher_matches(&activity_denylist_matcher, pid, comm)) {
+        return PROCESS_DENIED;
+    }
+    if (activity_allowlist_active() && app_matcher_matches(&activity_allowlist_matcher, pid, comm)) {
+        return PROCESS_ALLOWED;
+    }
+    return PROCESS_COUNTED;
+}
+
+static void close_process_files(struct attributed_process *process) {
+    if (process->stat_fd != -1) {
+        close(process->stat_fd);
+        process->stat_fd = -1;
+        attributed_cached_files--;
+    }
+    if (process->io_fd != -1) {
+        close(process->io_fd);
+        process->io_fd = -1;
+    }
+}
+
+/* Reads a /proc/<pid> file through the cached fd when there is one, else opens it for this read. */
+static ssize_t read_process_file(pid_t pid, const char *name, int fd, char *buffer, size_t size) {
+    ssize_t len;
+    if (fd != -1) {
+        len = pread(fd, buffer, size - 1, 0);
+    } else {
+        char path[32];
+        snprintf(path, sizeof(path), "%d/%s", (int)pid, name);
+        fd = openat(dirfd(attribution_proc_dir), path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return -1;
+        }
+        len = read(fd, buffer, size - 1);
+        close(fd);
+    }
+    if (len >= 0) {
+        buffer[len] = '\0';
+    }
+    return len;
+}
+
+static int read_process_stat(struct attributed_process *process, char *comm, unsigned long long *ticks,
+                             unsigned long long *start_time) {
+    char buffer[1024];
+    if (read_process_file(process->pid, "stat", process->stat_fd, buffer, sizeof(buffer)) <= 0) {
+        return 0;
+    }
+    char *open_paren = strchr(buffer, '(');
+    char *close_paren = strrchr(buffer, ')');
+    if (open_paren == NULL || close_paren == NULL || close_paren < open_paren) {
+        return 0;
+    }
+    size_t comm_length = close_paren - open_paren - 1;
+    if (comm_length >= TASK_COMM_LENGTH) comm_length = TASK_COMM_LENGTH - 1;
+    memcpy(comm, open_paren + 1, comm_length);
+    comm[comm_length] = '\0';
+
+    /* Field 3 (state) follows ") "; utime and stime are fields 14 and 15, starttime is 22. */
+    char *p = close_paren + 2;
+    unsigned long long fields[23] = {0};
+    for (int field = 3; field <= 22 && *p != '\0'; field++) {
+        fields[field] = strtoull(p, &p, 10);
+        if (field == 3) p++;
+        while (*p == ' ') p++;
+    }
+    *ticks = fields[14] + fields[15];
+    *start_time = fields[22];
+    return 1;
+}
+
+/* On failure errno says why; EACCES means the file belongs to another user. */
+static int read_process_io(struct attributed_process *process, unsigned long long *bytes) {
+    char buffer[512];
+    ssize_t len = read_process_file(process->pid, "io", process->io_fd, buffer, sizeof(buffer));
+    if (len <= 0) {
+        if (len == 0) errno = ENODATA;
+        return 0;
+    }
+    char *read_bytes = strstr(buffer, "read_bytes: ");
+    char *write_bytes = strstr(buffer, "\nwrite_bytes: ");
+    if (read_bytes == NULL || write_bytes == NULL) {
+        errno = EINVAL;
+        return 0;
+    }
+    *bytes = strtoull(read_bytes + 12, NULL, 10) + strtoull(write_bytes + 14, NULL, 10);
+    return 1;
+}
+
+static void cache_process_files(struct attributed_process *process) {
+    char path[32];
+    if (process->stat_fd == -1 && attributed_cached_files < MAX_CACHED_PROCESS_FILES) {
+        snprintf(path, sizeof(path), "%d/stat", (int)process->pid);
+        process->stat_fd = openat(dirfd(attribution_proc_dir), path, O_RDONLY | O_CLOEXEC);
+        if (process->stat_fd != -1) {
+            attributed_cached_files++;
+        }
+    }
+    if (process->stat_fd != -1 && process->io_fd == -1 && process->io_state != PROCESS_IO_UNREADABLE) {
+        snprintf(path, sizeof(path), "%d/io", (int)process->pid);
+        process->io_fd = openat(dirfd(attribution_proc_dir), path, O_RDONLY | O_CLOEXEC);
+    }
+}
+
+static void account_process(struct attributed_process *process, unsigned long long ticks, unsigned long long io_bytes) {
+    process->window_ticks += ticks;
+    process->window_io_bytes += io_bytes;
+    if (process->process_class == PROCESS_DENIED) {
+        attributed_totals.denied_ticks += ticks;
+        attributed_totals.denied_io_bytes += io_bytes;
+    } else if (process->process_class == PROCESS_ALLOWED) {
+        attributed_totals.allowed_ticks += ticks;
+        attributed_totals.allowed_io_bytes += io_bytes;
+    }
+}
+
+/* Accounts the CPU and I/O a known process used since it was last read. */
+static void update_process_usage(struct attributed_process *process, unsigned long long ticks) {
+    unsigned long long used_ticks = ticks > process->ticks ? ticks - process->ticks : 0;
+    process->ticks = ticks;
+    if (used_ticks == 0) {
+        close_process_files(process);
+        return;
+    }
+
+    cache_process_files(process);
+    unsigned long long io_bytes = 0, used_io_bytes = 0;
+    if (process->io_state != PROCESS_IO_UNREADABLE) {
+        if (read_process_io(process, &io_bytes)) {
+            if (process->io_state == PROCESS_IO_KNOWN && io_bytes > process->io_bytes) {
+                used_io_bytes = io_bytes - process->io_bytes;
+            }
+            process->io_bytes = io_bytes;
+            process->io_state = PROCESS_IO_KNOWN;
+        } else if (errno == EACCES) {
+            process->io_state = PROCESS_IO_UNREADABLE;
+            if (process->io_fd != -1) {
+                close(process->io_fd);
+                process->io_fd = -1;
+            }
+        }
+    }
+    account_process(process, used_ticks, used_io_bytes);
+}
+
+/* Between walks only the processes with open files are read; one that went quiet drops out until the next walk. */
+static void scan_cached_processes(void) {
+    struct attributed_process *table = attributed_processes[attributed_current];
+    for (int i = 0; i < attributed_counts[attributed_current]; i++) {
+        struct attributed_process *process = &table[i];
+        if (process->stat_fd == -1) {
+            continue;
+        }
+        char comm[TASK_COMM_LENGTH];
+        unsigned long long ticks, start_time;
+        if (!read_process_stat(process, comm, &ticks, &start_time)) {
+            close_process_files(process);
+            continue;
+        }
+        update_process_usage(process, ticks);
+    }
+}
+
+static void reset_process_window(void) {
+    struct attributed_process *table = attributed_processes[attributed_current];
+    for (int i = 0; i < attributed_counts[attributed_current]; i++) {
+        table[i].window_ticks = 0;
+        table[i].window_io_bytes = 0;
+    }
+    attribution_window_started_ms = monotonic_ms();
+}
+
+static void close_process_attribution(void) {
+    struct attributed_process *table = attributed_processes[attributed_current];
+    for (int i = 0; i < attributed_counts[attributed_current]; i++) {
+        close_process_files(&table[i]);
+    }
+    attributed_counts[attributed_current] = 0;
+    if (attribution_proc_dir != NULL) {
+        closedir(attribution_proc_dir);
+        attribution_proc_dir = NULL;
+    }
+    attribution_scan_ticks = 0;
+    attribution_cached_scans_left = 0;
+}
+
+static void scan_process_activity(struct process_totals *totals) {
+    memset(totals, 0, sizeof(*totals));
+    if (!process_attribution_active()) {
+        if (attribution_proc_dir != NULL) {
+            close_process_attribution();
+        }
+        return;
+    }
+    if (attribution_proc_dir == NULL) {
+        attribution_proc_dir = opendir("/proc");
+        if (attribution_proc_dir == NULL) {
+            return;
+        }
+        attribution_window_started_ms = monotonic_ms();
+    } else if (attribution_cached_scans_left > 0 && !attributed_classes_stale) {
+        attribution_cached_scans_left--;
+        scan_cached_processes();
+        *totals = attributed_totals;
+        totals->valid = 1;
+        return;
+    } else {
+        rewinddir(attribution_proc_dir);
+    }
+    /* The first walk only learns the counters, so the one after it is a full walk too. */
+    attribution_cached_scans_left = attribution_scan_ticks > 0 ? PROCESS_FULL_SCAN_INTERVAL - 1 : 0;
+
+    struct attributed_process *previous = attributed_processes[attributed_current];
+    struct attributed_process *current = attributed_processes[!attributed_current];
+    int previous_count = attributed_counts[attributed_current];
+    int count = 0;
+    int next = 0;
+
+    /* Start times in /proc/<pid>/stat are clock ticks since boot. */
+    struct timespec boot_time;
+    clock_gettime(CLOCK_BOOTTIME, &boot_time);
+    long ticks_per_second = sysconf(_SC_CLK_TCK);
+    unsigned long long scan_ticks = (unsigned long long)boot_time.tv_sec * ticks_per_second +
+                                    (unsigned long long)boot_time.tv_nsec * ticks_per_second / 1000000000ULL;
+
+    struct dirent *entry;
+    while ((entry = readdir(attribution_proc_dir)) != NULL && count < MAX_ATTRIBUTED_PROCESSES) {
+        if (!isdigit((unsigned char)entry->d_name[0])) {
+            continue;
+        }
+        pid_t pid = (pid_t)atoi(entry->d_name);
+        while (next < previous_count && previous[next].pid < pid) {
+            close_process_files(&previous[next++]);
+        }
+
+        struct attributed_process *process = &current[count];
+        int known = next < previous_count && previous[next].pid == pid;
+        if (known) {
+            *process = previous[next++];
+        } else {
+            memset(process, 0, sizeof(*process));
+            process->pid = pid;
+            process->stat_fd = -1;
+            process->io_fd = -1;
+        }
+
+        char comm[TASK_COMM_LENGTH];
+        unsigned long long ticks, start_time;
+        if (!read_process_stat(process, comm, &ticks, &start_time)) {
+            close_process_files(process);
+            continue;
+        }
+        if (known && start_time != process->start_time) {
+            close_process_files(process);
+            known = 0;
+        }
+        if (!known || attributed_classes_stale || strcmp(comm, process->comm) != 0) {
+            memcpy(process->comm, comm, sizeof(comm));
+            process->process_class = classify_process(pid, comm);
+        }
+        count++;
+
+        if (!known) {
+            process->start_time = start_time;
+            process->ticks = ticks;
+            process->io_state = PROCESS_IO_UNKNOWN;
+            process->window_ticks = 0;
+            process->window_io_bytes = 0;
+            /* Started since the previous walk, so all of its CPU time falls in between. */
+            if (attribution_scan_ticks > 0 && start_time >= attribution_scan_ticks && ticks > 0) {
+                account_process(process, ticks, 0);
+                cache_process_files(process);
+            }
+            continue;
+        }
+        update_process_usage(process, ticks);
+    }
+    while (next < previous_count) {
+        close_process_files(&previous[next++]);
+    }
+
+    attributed_counts[attributed_current] = 0;
+    attributed_current = !attributed_current;
+    attributed_counts[attributed_current] = count;
+    attributed_classes_stale = 0;
+    attribution_scan_ticks = scan_ticks;
+
+    *totals = attributed_totals;
+    totals->valid = 1;
+}
+
+/*
+ * Names the counted process that used the most CPU (or, when only I/O kept the machine awake,
+ * the most I/O) since the previous decision, then starts a new attribution window. A change of
+ * culprit is logged at info level; NULL just starts the new window.
+ */
+static void log_top_process(const struct activity_sample *sample) {
+    if (sample != NULL && process_attribution_active()) {
+        int by_io = sample->io_active && !sample->cpu_active;
+        const struct attributed_process *table = attributed_processes[attributed_current];
+        const struct attributed_process *top = NULL;
+        for (int i = 0; i < attributed_counts[attributed_current]; i++) {
+            const struct attributed_process *process = &table[i];
+            if (process->process_class == PROCESS_DENIED ||
+                (activity_allowlist_active() && process->process_class != PROCESS_ALLOWED)) {
+                continue;
+            }
+            if (top == NULL || (by_io ? process->window_io_bytes > top->window_io_bytes
+                                      : process->window_ticks > top->window_ticks)) {
+                top = process;
+            }
+        }
+
+        double seconds = (monotonic_ms() - attribution_window_started_ms) / 1000.0;
+        if (top != NULL && (by_io ? top->window_io_bytes : top->window_ticks) > 0 && seconds > 0) {
+            long ticks_per_second = sysconf(_SC_CLK_TCK);
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            double cpu = 100.0 * top->window_ticks / (ticks_per_second > 0 ? ticks_per_second : 100) /
+                         seconds / (cpus > 0 ? cpus : 1);
+            int changed = top->pid != top_process_pid || strcmp(top->comm, top_process_comm) != 0;
+            daemon_log(changed ? LOG_LEVEL_INFO : LOG_LEVEL_DEBUG,
+                       "Kept awake mostly by %s (PID %d): %.1f%% CPU, %.1f KB/s I/O over %.0f seconds",
+                       top->comm, (int)top->pid, cpu, top->window_io_bytes / 1024.0 / seconds, seconds);
+            memcpy(top_process_comm, top->comm, sizeof(top_process_comm));
+            top_process_pid = top->pid;
+        }
+    } else {
+        top_process_comm[0] = '\0';
+        top_process_pid = 0;
+    }
+    reset_process_window();
+}
+
+static Display *idle_display = NULL;
+static XScreenSaverInfo *idle_info = NULL;
+static volatile sig_atomic_t idle_display_lost = 0;
+static int display_from_environment = 0;
+static long last_idle_time = -1;
+static struct timespec last_idle_query;
+static int status_timeout_ms = 0;
+static int status_long_running = 0;
+static int sync_event_base = -1;
+static XSyncCounter idletime_counter = None;
+static XSyncAlarm idle_alarm = None;
+
+static int handle_x_io_error(Display *display) {
+    idle_display_lost = 1;
+    return 0;
+}
+
+static void handle_x_io_error_exit(Display *display, void *user_data) {
+    idle_display_lost = 1;
+}
+
+static int handle_x_error(Display *display, XErrorEvent *event) {
+    daemon_log(LOG_LEVEL_ERROR, "X protocol error %d (request %d)", event->error_code, event->request_code);
+    return 0;
+}
+
+/* Finds the local X session in utmp (what `who` shows as "(:0)") when DISPLAY was not inherited. */
+static void derive_x_session_environment(void) {
+    char display_name[64] = ":0";
+    char user[64] = "";
+
+    setutxent();
+    struct utmpx *entry;
+    while ((entry = getutxent()) != NULL) {
+        if (entry->ut_type != USER_PROCESS) {
+            continue;
+        }
+        const char *host = entry->ut_host[0] == ':' ? entry->ut_host :
+                           entry->ut_line[0] == ':' ? entry->ut_line : NULL;
+        if (host != NULL) {
+            snprintf(display_name, sizeof(display_name), "%.*s", (int)strcspn(host, " "), host);
+            snprintf(user, sizeof(user), "%.*s", (int)sizeof(entry->ut_user), entry->ut_user);
+            break;
+        }
+    }
+    endutxent();
+
+    setenv("DISPLAY", display_name, 1);
+    unsetenv("XAUTHORITY");
+
+    struct passwd *pw = user[0] ? getpwnam(user) : NULL;
+    if (pw == NULL) {
+        return;
+    }
+
+    char xauth_path[MAX_PATH_LENGTH];
+    snprintf(xauth_path, sizeof(xauth_path), "%s/.Xauthority", pw->pw_dir);
+    if (access(xauth_path, R_OK) == 0) {
+        setenv("XAUTHORITY", xauth_path, 1);
+    }
+}
+
+/* IDLETIME alarms let the daemon sleep until the X server reports the timeout was reached. */
+static int init_idle_alarms(Display *display) {
+    int error_base, major, minor;
+    idletime_counter = None;
+    idle_alarm = None;
+
+    if (!XSyncQueryExtension(display, &sync_event_base, &error_base) ||
+        !XSyncInitialize(display, &major, &minor)) {
+        sync_event_base = -1;
+        return 0;
+    }
+
+    int counter_count = 0;
+    XSyncSystemCounter *counters = XSyncListSystemCounters(display, &counter_count);
+    for (int i = 0; i < counter_count; i++) {
+        if (strcmp(counters[i].name, "IDLETIME") == 0) {
+            idletime_counter = counters[i].counter;
+            break;
+        }
+    }
+    if (counters != NULL) {
+        XSyncFreeSystemCounterList(counters);
+    }
+
+    if (idletime_counter == None) {
+        sync_event_base = -1;
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Arms the single IDLETIME alarm either to fire once idle time reaches idle_ms, or, when
+ * user_return is set, to fire as soon as the counter drops below idle_ms (the user came back).
+ * A zero delta makes the server deactivate the alarm after it triggers once.
+ */
+static void arm_idle_alarm(long idle_ms, int user_return) {
+    if (idle_display == NULL || idle_display_lost || sync_event_base < 0) {
+        return;
+    }
+
+    XSyncAlarmAttributes attributes;
+    attributes.trigger.counter = idletime_counter;
+    attributes.trigger.value_type = XSyncAbsolute;
+    attributes.trigger.test_type = user_return ? XSyncNegativeComparison : XSyncPositiveComparison;
+    XSyncIntToValue(&attributes.trigger.wait_value, (int)(idle_ms > INT_MAX ? INT_MAX : idle_ms));
+    XSyncIntToValue(&attributes.delta, 0);
+    attributes.events = True;
+
+    unsigned long mask = XSyncCACounter | XSyncCAValueType | XSyncCAValue |
+                         XSyncCATestType | XSyncCADelta | XSyncCAEvents;
+    if (idle_alarm == None) {
+        idle_alarm = XSyncCreateAlarm(idle_display, mask, &attributes);
+    } else {
+        XSyncChangeAlarm(idle_display, idle_alarm, mask, &attributes);
+    }
+    XFlush(idle_display);
+}
+
+enum daemon_event_source {
+    EVENT_SIGNAL,
+    EVENT_DECISION_TIMER,
+    EVENT_SAMPLE_TIMER,
+    EVENT_X_CONNECTION,
+    EVENT_CONFIG_DIRECTORY,
+    EVENT_CONTROL_SOCKET,
+    EVENT_CONTROL_CLIENT,
+    EVENT_CHILD_PROCESS,
+    EVENT_PROC_CONNECTOR,
+    EVENT_PRESSURE_CPU,
+    EVENT_PRESSURE_IO,
+    EVENT_PRESSURE_MEMORY
+};
+
+/*
+ * Everything the daemon waits for is one fd in a single epoll set: the X connection, a timerfd
+ * for the next decision, a timerfd for the next background sample, the signalfd, inotify on
+ * ~/.XorgIdleManager, the control socket, a pidfd per running action command and the PSI
+ * triggers, and the proc connector. Between deadlines and events the process does not wake up.
+ */
+static int event_epoll_fd = -1;
+static int decision_timer_fd = -1;
+static int sample_timer_fd = -1;
+static int config_inotify_fd = -1;
+static int control_socket_fd = -1;
+static int daemon_lock_fd = -1;
+static int event_x_fd = -1;
+
+static void watch_event_source_for(int fd, int source, uint32_t events) {
+    struct epoll_event event = {0};
+    event.events = events;
+    event.data.u32 = source;
+    if (fd != -1 && epoll_ctl(event_epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        daemon_log(LOG_LEVEL_WARNING, "Failed to watch event source %d: %s", source, strerror(errno));
+    }
+}
+
+static void watch_event_source(int fd, int source) {
+    watch_event_source_for(fd, source, EPOLLIN);
+}
+
+/* at_ms is on the CLOCK_MONOTONIC scale of monotonic_ms(); LLONG_MAX disarms the timer. */
+static void arm_event_timer(int fd, long long at_ms) {
+    struct itimerspec spec = {0};
+    if (at_ms != LLONG_MAX) {
+        if (at_ms < 1) at_ms = 1;
+        spec.it_value.tv_sec = at_ms / 1000;
+        spec.it_value.tv_nsec = (at_ms % 1000) * 1000000;
+    }
+    timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static void read_event_timer(int fd) {
+    uint64_t expirations;
+    while (read(fd, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations)) {
+    }
+}
+
+/* The X connection is only watched while an IDLETIME alarm is armed on it. */
+static void sync_x_event_source(void) {
+    int fd = idle_display != NULL && !idle_display_lost && idle_alarm != None ? ConnectionNumber(idle_display) : -1;
+    if (fd == event_x_fd) {
+        return;
+    }
+    if (event_x_fd != -1) {
+        epoll_ctl(event_epoll_fd, EPOLL_CTL_DEL, event_x_fd, NULL);
+    }
+    event_x_fd = fd;
+    watch_event_source(event_x_fd, EVENT_X_CONNECTION);
+}
+
+/* Only writes that complete config.ini (saved in place or renamed over it) count as a change. */
+static void read_config_directory_events(void) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(config_inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + len; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->len > 0 && strcmp(event->name, "config.ini") == 0) {
+                daemon_reload_requested = 1;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+static void log_daemon_status(void) {
+    long long now = monotonic_ms();
+    daemon_log(LOG_LEVEL_INFO, "Status: X idle %ld ms, %d long-running app process(es), %d samples in the activity window, next decision in %lld ms",
+               last_idle_time, long_running_count, activity_window_state.count,
+               next_decision_ms > now ? next_decision_ms - now : 0);
+    for (int s = 0; s < ACTIVITY_SIGNALS; s++) {
+        if (!activity_signal_enabled(s)) {
+            continue;
+        }
+        daemon_log(LOG_LEVEL_INFO, "Status: %s is %s (smoothed %.2f)", activity_signal_names[s],
+                   activity_engine[s].active ? "active" : "idle", activity_engine[s].smoothed);
+    }
+    daemon_log_flush();
+}
+
+
+static int reload_daemon_config(int force);
+
+/*
+ * The control socket is ~/.XorgIdleManager/control.sock, in a directory only the user can write
+ * to, so no other account can take its place; only that user and root may talk to it. The
+ * daemon holds an flock on daemon.lock next to it for as long as it runs, which makes the
+ * single-instance check race-free and lets a socket left behind by a crash be replaced. Each
+ * connection carries one command line and gets "ok" or "error <reason>" followed by key=value
+ * lines, then EOF.
+ *   status                  idle time, timeout in effect, matched app, rates, time to action
+ *   subscribe               "ok", then a status block each time the state changes
+ *   stop                    graceful shutdown
+ *   reload                  apply config.ini now and report whether it was accepted
+ *   samples [SINCE [UNTIL]] the sample history as CSV (times as for --samples)
+ */
+/* Returns 0 when $HOME is too long for a socket path. */
+static socklen_t control_socket_address(struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    int length = snprintf(address->sun_path, sizeof(address->sun_path), "%s/.XorgIdleManager/control.sock", getenv("HOME"));
+    if (length < 0 || (size_t)length >= sizeof(address->sun_path)) {
+        return 0;
+    }
+    return offsetof(struct sockaddr_un, sun_path) + length + 1;
+}
+
+int open_control_socket(void) {
+    struct sockaddr_un address;
+    socklen_t length = control_socket_address(&address);
+    if (length == 0) {
+        daemon_log(LOG_LEVEL_ERROR, "Failed to open the control socket: the path under $HOME is too long");
+        return 0;
+    }
+
+    char lock_path[MAX_PATH_LENGTH];
+    snprintf(lock_path, sizeof(lock_path), "%s/.XorgIdleManager/daemon.lock", getenv("HOME"));
+    daemon_lock_fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (daemon_lock_fd == -1 || flock(daemon_lock_fd, LOCK_EX | LOCK_NB) == -1) {
+        if (errno == EWOULDBLOCK) {
+            daemon_log(LOG_LEVEL_ERROR, "Another daemon is already running for this user");
+        } else {
+            daemon_log(LOG_LEVEL_ERROR, "Failed to lock %s: %s", lock_path, strerror(errno));
+        }
+        if (daemon_lock_fd != -1) {
+            close(daemon_lock_fd);
+            daemon_lock_fd = -1;
+        }
+        return 0;
+    }
+
+    /* Holding the lock means any socket file still there is stale. */
+    unlink(address.sun_path);
+    control_socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (control_socket_fd == -1 ||
+        bind(control_socket_fd, (struct sockaddr *)&address, length) == -1 ||
+        listen(control_socket_fd, 8) == -1) {
+        daemon_log(LOG_LEVEL_ERROR, "Failed to open the control socket: %s", strerror(errno));
+        if (control_socket_fd != -1) {
+            close(control_socket_fd);
+            control_socket_fd = -1;
+        }
+        return 0;
+    }
+    watch_event_source(control_socket_fd, EVENT_CONTROL_SOCKET);
+    return 1;
+}
+
+static void write_control_status(FILE *out) {
+    static const char *keys[ACTIVITY_SIGNALS] = {"cpu", "io", "net", "cgroup_cpu", "cgroup_io"};
+    long long now = monotonic_ms();
+    int gui = idle_display != NULL && !idle_display_lost;
+
+    long idle = -1;
+    if (gui && last_idle_time >= 0) {
+        struct timespec query_time;
+        clock_gettime(CLOCK_MONOTONIC, &query_time);
+        idle = last_idle_time + (query_time.tv_sec - last_idle_query.tv_sec) * 1000L +
+               (query_time.tv_nsec - last_idle_query.tv_nsec) / 1000000L;
+    }
+    long long next_decision = next_decision_ms > now ? next_decision_ms - now : 0;
+    long long time_to_action = idle >= 0 ? (status_timeout_ms > idle ? status_timeout_ms - idle : 0) : next_decision;
+
+    char matched_app[32] = "";
+    find_matched_long_running_app(matched_app, sizeof(matched_app));
+
+    fprintf(out, "pid=%d\n", (int)getpid());
+    fprintf(out, "started=%lld\n", (long long)daemon_start_time);
+    fprintf(out, "x_server=%d\n", gui);
+    fprintf(out, "idle_ms=%ld\n", idle);
+    fprintf(out, "timeout_ms=%d\n", status_timeout_ms);
+    fprintf(out, "long_running_timeout=%d\n", status_long_running);
+    fprintf(out, "time_to_action_ms=%lld\n", time_to_action);
+    fprintf(out, "next_decision_ms=%lld\n", next_decision);
+    fprintf(out, "long_running_apps=%d\n", long_running_count);
+    fprintf(out, "matched_app=%s\n", matched_app);
+    fprintf(out, "top_process=%s\n", top_process_comm);
+    fprintf(out, "top_process_pid=%d\n", (int)top_process_pid);
+    fprintf(out, "cpu_usage=%.2f\n", latest_cpu_usage);
+    fprintf(out, "io_kbps=%.2f\n", latest_io_kbps);
+    fprintf(out, "net_kbps=%.2f\n", latest_net_kbps);
+    if (pressure_source_active()) {
+        fprintf(out, "cpu_pressure=%.2f\n", latest_pressure[PRESSURE_CPU]);
+        fprintf(out, "io_pressure=%.2f\n", latest_pressure[PRESSURE_IO]);
+        fprintf(out, "memory_pressure=%.2f\n", latest_pressure[PRESSURE_MEMORY]);
+    }
+    if (cgroup_probe_active()) {
+        fprintf(out, "cgroup_cpu_usage=%.2f\n", latest_cgroup_cpu_usage);
+        fprintf(out, "cgroup_io_kbps=%.2f\n", latest_cgroup_io_kbps);
+    }
+    for (int s = 0; s < ACTIVITY_SIGNALS; s++) {
+        fprintf(out, "%s_active=%d\n", keys[s], activity_engine[s].active);
+        fprintf(out, "%s_smoothed=%.2f\n", keys[s], activity_engine[s].smoothed);
+    }
+}
+
+static void write_control_samples(FILE *out, char *arguments) {
+    int64_t since = INT64_MIN, until = INT64_MAX;
+    char *since_text = strtok(arguments, " ");
+    char *until_text = since_text != NULL ? strtok(NULL, " ") : NULL;
+    if ((since_text != NULL && !parse_sample_time(since_text, &since)) ||
+        (until_text != NULL && !parse_sample_time(until_text, &until))) {
+        fprintf(out, "error invalid time\n");
+        return;
+    }
+    if (sample_ring == NULL) {
+        fprintf(out, "error sample history is not available\n");
+        return;
+    }
+    fprintf(out, "ok\n");
+    write_sample_records(out, sample_ring, since, until, 0);
+}
+
+/*
+ * Subscribers keep their connection open and get the status block (terminated by an empty
+ * line) whenever something changed. Changes only set status_changed; the loop publishes once
+ * before it blocks again, so bursts of events coalesce into one update.
+ */
+static int control_subscribers[MAX_CONTROL_SUBSCRIBERS];
+static int control_subscriber_count = 0;
+
+static void add_control_subscriber(int fd) {
+    if (fd == -1) {
+        return;
+    }
+    if (control_subscriber_count == MAX_CONTROL_SUBSCRIBERS) {
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    control_subscribers[control_subscriber_count++] = fd;
+}
+
+static void remove_control_subscriber(int index) {
+    close(control_subscribers[index]);
+    control_subscribers[index] = control_subscribers[--control_subscriber_count];
+}
+
+static void publish_control_status(void) {
+    if (!status_changed || control_subscriber_count == 0) {
+        return;
+    }
+    status_changed = 0;
+
+    char status[CONTROL_STATUS_SIZE];
+    FILE *out = fmemopen(status, sizeof(status), "w");
+    if (out == NULL) {
+        return;
+    }
+    write_control_status(out);
+    fputc('\n', out);
+    long length = ftell(out);
+    fclose(out);
+
+    /* Subscribers that went away, or are too slow to take a whole block, are dropped here. */
+    for (int i = control_subscriber_count - 1; i >= 0; i--) {
+        if (send(control_subscribers[i], status, length, MSG_NOSIGNAL | MSG_DONTWAIT) != length) {
+            remove_control_subscriber(i);
+        }
+    }
+}
+
+/* Runs one command and answers it; returns 1 when a reload applied new settings and the wait should end. */
+static int answer_control_command(int client, char *command) {
+    FILE *out = fdopen(client, "w");
+    if (out == NULL) {
+        close(client);
+        return 0;
+    }
+
+    int applied = 0;
+    char *arguments = command + strcspn(command, " ");
+    if (*arguments != '\0') {
+        *arguments++ = '\0';
+    }
+    daemon_log(LOG_LEVEL_DEBUG, "Control command: %s", command);
+
+    if (strcmp(command, "status") == 0) {
+        fprintf(out, "ok\n");
+        write_control_status(out);
+    } else if (strcmp(command, "subscribe") == 0) {
+        fprintf(out, "ok\n");
+        fflush(out);
+        add_control_subscriber(dup(client));
+        status_changed = 1;
+    } else if (strcmp(command, "stop") == 0) {
+        daemon_log(LOG_LEVEL_INFO, "Stop requested over the control socket");
+        daemon_stop_requested = 1;
+        fprintf(out, "ok\n");
+    } else if (strcmp(command, "reload") == 0) {
+        applied = reload_daemon_config(0);
+        if (last_reload_ok) {
+            fprintf(out, "ok\n");
+        } else {
+            fprintf(out, "error %s\n", last_reload_error);
+        }
+    } else if (strcmp(command, "samples") == 0) {
+        write_control_samples(out, arguments);
+    } else {
+        fprintf(out, "error unknown command\n");
+    }
+    fclose(out);
+    return applied;
+}
+
+/*
+ * Accepted connections sit in the epoll set until their command line is complete, so a client
+ * that connects and says nothing does not hold up the loop. Clients that stay silent past
+ * their deadline are dropped once the table is full.
+ */
+struct control_client {
+    int fd;
+    long long deadline_ms;
+    size_t length;
+    char command[CONTROL_COMMAND_SIZE];
+};
+
+static struct control_client control_clients[MAX_CONTROL_CLIENTS];
+static int control_client_count = 0;
+
+static void remove_control_client(int index, int close_fd) {
+    epoll_ctl(event_epoll_fd, EPOLL_CTL_DEL, control_clients[index].fd, NULL);
+    if (close_fd) {
+        close(control_clients[index].fd);
+    }
+    control_clients[index] = control_clients[--control_client_count];
+}
+
+static void accept_control_connection(void) {
+    int client = accept4(control_socket_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (client == -1) {
+        return;
+    }
+
+    struct ucred credentials;
+    socklen_t credentials_length = sizeof(credentials);
+    if (getsockopt(client, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_length) == -1 ||
+        (credentials.uid != getuid() && credentials.uid != 0)) {
+        close(client);
+        return;
+    }
+
+    long long now = monotonic_ms();
+    for (int i = control_client_count - 1; i >= 0 && control_client_count == MAX_CONTROL_CLIENTS; i--) {
+        if (control_clients[i].deadline_ms <= now) {
+            remove_control_client(i, 1);
+        }
+    }
+    if (control_client_count == MAX_CONTROL_CLIENTS) {
+        close(client);
+        return;
+    }
+
+    /* Reads never block; a reply to a client that stops reading gives up after the timeout. */
+    struct timeval timeout = {CONTROL_CLIENT_TIMEOUT_MS / 1000, 0};
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    struct control_client *entry = &control_clients[control_client_count++];
+    entry->fd = client;
+    entry->deadline_ms = now + CONTROL_CLIENT_TIMEOUT_MS;
+    entry->length = 0;
+    watch_event_source(client, EVENT_CONTROL_CLIENT);
+}
+
+/* Reads whatever the pending clients sent; returns 1 when a reload applied new settings. */
+static int read_control_clients(void) {
+    int applied = 0;
+    for (int i = control_client_count - 1; i >= 0; i--) {
+        struct control_client *entry = &control_clients[i];
+        ssize_t len = recv(entry->fd, entry->command + entry->length,
+                           sizeof(entry->command) - 1 - entry->length, MSG_DONTWAIT);
+        if (len == -1 && (errno == EAGAIN || errno == EINTR)) {
+            continue;
+        }
+        if (len > 0) {
+            entry->length += len;
+            if (memchr(entry->command, '\n', entry->length) == NULL &&
+                entry->length < sizeof(entry->command) - 1) {
+                continue;
+            }
+        }
+
+        /* End of stream, a full line or a full buffer: answer with what arrived. */
+        int client = entry->fd;
+        char command[CONTROL_COMMAND_SIZE];
+        memcpy(command, entry->command, entry->length);
+        command[entry->length] = '\0';
+        command[strcspn(command, "\r\n")] = '\0';
+        remove_control_client(i, 0);
+        if (len == -1) {
+            close(client);
+            continue;
+        }
+        applied |= answer_control_command(client, command);
+    }
+    return applied;
+}
+
+/*
+ * Connects to the running daemon and sends one command; -1 means no daemon is listening, or
+ * the one listening does not belong to this user.
+ */
+int connect_control_socket(const char *command, int timeout_seconds) {
+    struct sockaddr_un address;
+    socklen_t length = control_socket_address(&address);
+    if (length == 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    struct ucred credentials;
+    socklen_t credentials_length = sizeof(credentials);
+    if (connect(fd, (struct sockaddr *)&address, length) == -1 ||
+        getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_length) == -1 ||
+        credentials.uid != getuid()) {
+        close(fd);
+        return -1;
+    }
+    struct timeval timeout = {timeout_seconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char line[256];
+    int line_length = snprintf(line, sizeof(line), "%s\n", command);
+    if (send(fd, line, line_length, MSG_NOSIGNAL) != line_length) {
+        close(fd);
+        return -1;
+    }
+    shutdown(fd, SHUT_WR);
+    return fd;
+}
+
+/*
+ * Sends a command and collects the reply. Returns -1 when no daemon is running, 1 when it
+ * answered "ok", and 0 otherwise (reply then holds the reason, or is empty after a timeout).
+ */
+int send_control_command(const char *command, char *reply, size_t size) {
+    int fd = connect_control_socket(command, 5);
+    if (fd == -1) {
+        return -1;
+    }
+
+    size_t length = 0;
+    ssize_t len;
+    while (length < size - 1 && (len = recv(fd, reply + length, size - 1 - length, 0)) > 0) {
+        length += len;
+    }
+    reply[length] = '\0';
+    close(fd);
+
+    if (strncmp(reply, "ok", 2) == 0 && (reply[2] == '\n' || reply[2] == '\0')) {
+        return 1;
+    }
+    if (strncmp(reply, "error ", 6) == 0) {
+        memmove(reply, reply + 6, strlen(reply + 6) + 1);
+        reply[strcspn(reply, "\n")] = '\0';
+    }
+    return 0;
+}
+
+/* XorgIdleManager --control status|stop|reload|samples [SINCE [UNTIL]] */
+int run_control_command(int argc, char *argv[]) {
+    char command[256] = "";
+    for (int i = 2; i < argc; i++) {
+        size_t used = strlen(command);
+        snprintf(command + used, sizeof(command) - used, "%s%s", used ? " " : "", argv[i]);
+    }
+    if (command[0] == '\0') {
+        fprintf(stderr, "Usage: %s --control status|stop|reload|samples [SINCE [UNTIL]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int fd = connect_control_socket(command, 5);
+    if (fd == -1) {
+        fprintf(stderr, "XorgIdleManager daemon is not running.\n");
+        return EXIT_FAILURE;
+    }
+
+    char buffer[4096];
+    char status[3] = "";
+    size_t status_length = 0;
+    ssize_t len;
+    while ((len = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        for (ssize_t i = 0; i < len && status_length < 2; i++) {
+            status[status_length++] = buffer[i];
+        }
+        fwrite(buffer, 1, len, stdout);
+    }
+    close(fd);
+    return strcmp(status, "ok") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int init_event_loop(void) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+
+    daemon_signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    event_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    decision_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    sample_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (daemon_signal_fd == -1 || event_epoll_fd == -1 || decision_timer_fd == -1 || sample_timer_fd == -1) {
+        daemon_log(LOG_LEVEL_ERROR, "Failed to set up the event loop: %s", strerror(errno));
+        return 0;
+    }
+
+    watch_event_source(daemon_signal_fd, EVENT_SIGNAL);
+    watch_event_source(decision_timer_fd, EVENT_DECISION_TIMER);
+    watch_event_source(sample_timer_fd, EVENT_SAMPLE_TIMER);
+
+    char config_dir[MAX_PATH_LENGTH];
+    snprintf(config_dir, sizeof(config_dir), "%s/.XorgIdleManager", getenv("HOME"));
+    config_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (config_inotify_fd == -1 || inotify_add_watch(config_inotify_fd, config_dir, IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+        daemon_log(LOG_LEVEL_WARNING, "Cannot watch %s for config.ini changes: %s", config_dir, strerror(errno));
+        if (config_inotify_fd != -1) {
+            close(config_inotify_fd);
+            config_inotify_fd = -1;
+        }
+    }
+    watch_event_source(config_inotify_fd, EVENT_CONFIG_DIRECTORY);
+    return 1;
+}
+
+/*
+ * With psi_trigger_ms set, each /proc/pressure file also gets a trigger ("some <stall> <window>")
+ * on a descriptor of its own, and the kernel signals EPOLLPRI when the tasks stalled that long
+ * within PSI_TRIGGER_WINDOW_MS. A burst marks the signal active at once, so an action that was
+ * about to be taken is held off without waiting for the averages to catch up.
+ */
+static int pressure_trigger_fds[PRESSURE_RESOURCES] = {-1, -1, -1};
+
+static void close_pressure_triggers(void) {
+    for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+        if (pressure_trigger_fds[i] != -1) {
+            close(pressure_trigger_fds[i]);
+            pressure_trigger_fds[i] = -1;
+        }
+    }
+}
+
+static void open_pressure_triggers(void) {
+    close_pressure_triggers();
+    if (psi_trigger_ms <= 0 || !pressure_source_active()) {
+        return;
+    }
+    for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+        char path[32], trigger[64];
+        snprintf(path, sizeof(path), "/proc/pressure/%s", pressure_names[i]);
+        int length = snprintf(trigger, sizeof(trigger), "some %d %d", psi_trigger_ms * 1000, PSI_TRIGGER_WINDOW_MS * 1000);
+        int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd == -1 || write(fd, trigger, length + 1) == -1) {
+            daemon_log(LOG_LEVEL_WARNING, "Cannot register a pressure trigger on %s: %s", path, strerror(errno));
+            if (fd != -1) close(fd);
+            continue;
+        }
+        pressure_trigger_fds[i] = fd;
+        watch_event_source_for(fd, EVENT_PRESSURE_CPU + i, EPOLLPRI);
+    }
+}
+
+static void handle_pressure_trigger(int resource) {
+    int signal = resource == PRESSURE_CPU ? ACTIVITY_CPU : ACTIVITY_IO;
+    struct activity_engine_signal *engine = &activity_engine[signal];
+    double enter, exit;
+    activity_engine_thresholds(signal, &enter, &exit);
+
+    daemon_log(LOG_LEVEL_DEBUG, "Pressure trigger on %s: %d ms of stall within %d ms", pressure_names[resource],
+               psi_trigger_ms, PSI_TRIGGER_WINDOW_MS);
+    long long now = monotonic_ms();
+    engine->seeded = 1;
+    engine->pending_since_ms = 0;
+    if (engine->smoothed <= enter) {
+        engine->smoothed = enter + 1;
+    }
+    if (!engine->active) {
+        engine->active = 1;
+        engine->changed_ms = now;
+        push_activity_event(signal, 1, engine->smoothed, now);
+        drain_activity_events();
+    }
+}
+
+/*
+ * Action commands run in a process group of their own and are supervised through a pidfd in
+ * the epoll set, so timers and the control socket are served while one runs and it is reaped
+ * as soon as it exits. Without pidfd support (Linux < 5.3) the command is waited for in place.
+ */
+#define MAX_CHILD_PROCESSES 8
+#define CHILD_STOP_GRACE_MS 3000
+
+struct child_process {
+    pid_t pid;
+    int pidfd;
+};
+
+static struct child_process child_processes[MAX_CHILD_PROCESSES];
+static int child_process_count = 0;
+
+static void log_child_exit(int status) {
+    if (WIFSIGNALED(status)) {
+        daemon_log(LOG_LEVEL_INFO, "Action command terminated by signal %d", WTERMSIG(status));
+    } else {
+        daemon_log(LOG_LEVEL_INFO, "Action command finished with status %d", WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    }
+}
+
+static int supervise_child_process(pid_t pid) {
+    if (child_process_count == MAX_CHILD_PROCESSES) {
+        return 0;
+    }
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd == -1) {
+        return 0;
+    }
+    watch_event_source(pidfd, EVENT_CHILD_PROCESS);
+    child_processes[child_process_count].pid = pid;
+    child_processes[child_process_count].pidfd = pidfd;
+    child_process_count++;
+    return 1;
+}
+
+static void reap_child_processes(void) {
+    for (int i = child_process_count - 1; i >= 0; i--) {
+        int status;
+        if (waitpid(child_processes[i].pid, &status, WNOHANG) != child_processes[i].pid) {
+            continue;
+        }
+        log_child_exit(status);
+        close(child_processes[i].pidfd);
+        child_processes[i] = child_processes[--child_process_count];
+    }
+}
+
+/* Sends SIGTERM to each running command's process group, and SIGKILL after the grace period. */
+static void stop_child_processes(void) {
+    if (child_process_count == 0) {
+        return;
+    }
+    daemon_log(LOG_LEVEL_INFO, "Stopping %d running action command(s)", child_process_count);
+    for (int i = 0; i < child_process_count; i++) {
+        kill(-child_processes[i].pid, SIGTERM);
+    }
+
+    long long deadline = monotonic_ms() + CHILD_STOP_GRACE_MS;
+    for (;;) {
+        reap_child_processes();
+        long long remaining = deadline - monotonic_ms();
+        if (child_process_count == 0 || remaining <= 0) {
+            break;
+        }
+        struct pollfd fds[MAX_CHILD_PROCESSES];
+        for (int i = 0; i < child_process_count; i++) {
+            fds[i].fd = child_processes[i].pidfd;
+            fds[i].events = POLLIN;
+        }
+        poll(fds, child_process_count, (int)remaining);
+    }
+
+    while (child_process_count > 0) {
+        struct child_process *child = &child_processes[child_process_count - 1];
+        int status;
+        daemon_log(LOG_LEVEL_WARNING, "Action command (PID %d) did not exit, killing its process group", (int)child->pid);
+        kill(-child->pid, SIGKILL);
+        waitpid(child->pid, &status, 0);
+        log_child_exit(status);
+        close(child->pidfd);
+        child_process_count--;
+    }
+}
+
+void close_event_loop(void) {
+    while (control_subscriber_count > 0) {
+        remove_control_subscriber(control_subscriber_count - 1);
+    }
+    while (control_client_count > 0) {
+        remove_control_client(control_client_count - 1, 1);
+    }
+    if (control_socket_fd != -1) {
+        struct sockaddr_un address;
+        if (control_socket_address(&address) != 0) {
+            unlink(address.sun_path);
+        }
+    }
+    int *fds[] = {&control_socket_fd, &daemon_lock_fd, &config_inotify_fd, &sample_timer_fd, &decision_timer_fd, &event_epoll_fd, &daemon_signal_fd};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (*fds[i] != -1) {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+    event_x_fd = -1;
+}
+
+/*
+ * Runs the event loop until the IDLETIME alarm fires, the decision timer expires or a stop is
+ * requested. Background samples, signals and config changes are handled in between without
+ * ending the wait.
+ */
+static void wait_for_idle_event(int seconds) {
+    arm_event_timer(decision_timer_fd, monotonic_ms() + (long long)seconds * 1000);
+    sync_x_event_source();
+
+    for (;;) {
+        if (event_x_fd != -1) {
+            while (XPending(idle_display) > 0) {
+                XEvent event;
+                XNextEvent(idle_display, &event);
+                if (event.type == sync_event_base + XSyncAlarmNotify) {
+                    daemon_log(LOG_LEVEL_DEBUG, "IDLETIME alarm fired");
+                    return;
+                }
+            }
+            if (idle_display_lost) {
+                return;
+            }
+        }
+        if (daemon_stop_requested) {
+            return;
+        }
+        if (daemon_status_requested) {
+            daemon_status_requested = 0;
+            log_daemon_status();
+        }
+        if (daemon_reload_requested) {
+            int force = daemon_reload_forced;
+            daemon_reload_requested = 0;
+            daemon_reload_forced = 0;
+            /* A new policy gets an immediate decision; idle time itself is kept by the X server. */
+            if (reload_daemon_config(force)) {
+                return;
+            }
+        }
+
+        publish_control_status();
+        arm_event_timer(sample_timer_fd, next_sample_due_ms(monotonic_ms()));
+
+        struct epoll_event events[8];
+        int count = epoll_wait(event_epoll_fd, events, 8, -1);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            daemon_log(LOG_LEVEL_ERROR, "epoll_wait failed: %s", strerror(errno));
+            daemon_sleep(seconds);
+            return;
+        }
+
+        int decide = 0;
+        for (int i = 0; i < count; i++) {
+            switch (events[i].data.u32) {
+            case EVENT_SIGNAL:
+                read_daemon_signals();
+                break;
+            case EVENT_DECISION_TIMER:
+                read_event_timer(decision_timer_fd);
+                decide = 1;
+                break;
+            case EVENT_SAMPLE_TIMER:
+                read_event_timer(sample_timer_fd);
+                activity_sampler_tick();
+                drain_activity_events();
+                if (decision_waits_for_sample && activity_window_state.count > 0) {
+                    decision_waits_for_sample = 0;
+                    decide = 1;
+                }
+                break;
+            case EVENT_CONFIG_DIRECTORY:
+                read_config_directory_events();
+                break;
+            case EVENT_CONTROL_SOCKET:
+                accept_control_connection();
+                break;
+            case EVENT_CONTROL_CLIENT:
+                decide |= read_control_clients();
+                break;
+            case EVENT_CHILD_PROCESS:
+                reap_child_processes();
+                break;
+            case EVENT_PROC_CONNECTOR: {
+                /* A long-running app starting or exiting changes the timeout in effect. */
+                int was_active = long_running_count > 0;
+                drain_proc_connector();
+                if ((long_running_count > 0) != was_active) {
+                    status_changed = 1;
+                    decide = 1;
+                }
+                break;
+            }
+            case EVENT_PRESSURE_CPU:
+            case EVENT_PRESSURE_IO:
+            case EVENT_PRESSURE_MEMORY:
+                handle_pressure_trigger(events[i].data.u32 - EVENT_PRESSURE_CPU);
+                break;
+            default:
+                break;
+            }
+        }
+        if (decide) {
+            return;
+        }
+    }
+}
+
+void close_idle_display(void) {
+    if (idle_info != NULL) {
+        XFree(idle_info);
+        idle_info = NULL;
+    }
+    if (idle_display != NULL) {
+        if (event_x_fd != -1) {
+            epoll_ctl(event_epoll_fd, EPOLL_CTL_DEL, event_x_fd, NULL);
+            event_x_fd = -1;
+        }
+        if (idle_alarm != None && !idle_display_lost) {
+            XSyncDestroyAlarm(idle_display, idle_alarm);
+        }
+        XCloseDisplay(idle_display);
+        idle_display = NULL;
+    }
+    idle_alarm = None;
+    sync_event_base = -1;
+    idle_display_lost = 0;
+    last_idle_time = -1;
+}
+
+/* Keeps one X connection open for the daemon's lifetime and reconnects after the server goes away. */
+Display *open_idle_display(void) {
+    if (idle_display != NULL && !idle_display_lost) {
+        return idle_display;
+    }
+    if (idle_display != NULL) {
+        daemon_log(LOG_LEVEL_WARNING, "Connection to X server lost, reconnecting");
+        close_idle_display();
+    }
+
+    if (!display_from_environment) {
+        derive_x_session_environment();
+    }
+
+    idle_display = XOpenDisplay(NULL);
+    if (idle_display == NULL) {
+        return NULL;
+    }
+    XSetIOErrorExitHandler(idle_display, handle_x_io_error_exit, NULL);
+
+    int event_base, error_base;
+    if (!XScreenSaverQueryExtension(idle_display, &event_base, &error_base) ||
+        (idle_info = XScreenSaverAllocInfo()) == NULL) {
+        daemon_log(LOG_LEVEL_WARNING, "MIT-SCREEN-SAVER extension is not available on DISPLAY=%s", getenv("DISPLAY"));
+        close_idle_display();
+        return NULL;
+    }
+
+    daemon_log(LOG_LEVEL_INFO, "Connected to X server (DISPLAY=%s, XAUTHORITY=%s)",
+               getenv("DISPLAY"), getenv("XAUTHORITY") ? getenv("XAUTHORITY") : "unset");
+    if (!init_idle_alarms(idle_display)) {
+        daemon_log(LOG_LEVEL_WARNING, "XSync IDLETIME counter is not available, falling back to Check Interval polling");
+    }
+    return idle_display;
+}
+
+int check_gui(void) {
+    daemon_log(LOG_LEVEL_DEBUG, "Checking for GUI with X server");
+
+    if (open_idle_display() == NULL) {
+        daemon_log(LOG_LEVEL_DEBUG, "No active X server found (DISPLAY=%s)", getenv("DISPLAY"));
+        return 0;
+    }
+
+    daemon_log(LOG_LEVEL_DEBUG, "X server is active (DISPLAY=%s)", getenv("DISPLAY"));
+    return 1;
+}
 
-    char *copy = strdup(command);
-    if (!copy) return 0;
+/*
+ * Idle time can only grow as fast as the monotonic clock (both stop during suspend), and can
+ * never exceed the time since boot. Readings that break either rule are the anomalies v1.6
+ * guarded against and are rejected rather than acted upon.
+ */
+long query_user_idle_time(void) {
+    if (open_idle_display() == NULL) {
+        return -1;
+    }
 
-    int valid = 1;
-    char *token = strtok(copy, ";");
-    while (token && valid) {
-        char *trimmed = token;
-        while (*trimmed == ' ') trimmed++;
+    if (!XScreenSaverQueryInfo(idle_display, DefaultRootWindow(idle_display), idle_info) || idle_display_lost) {
+        return -1;
+    }
+
+    long idle = (long)idle_info->idle;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    long uptime_ms = read_uptime_seconds() * 1000L;
+    if (idle < 0 || (uptime_ms > 0 && idle > uptime_ms + 60000L)) {
+        daemon_log(LOG_LEVEL_WARNING, "Rejecting anomalous idle time %ld ms (uptime %ld ms)", idle, uptime_ms);
+        return -1;
+    }
+
+    if (last_idle_time >= 0) {
+        long elapsed = (now.tv_sec - last_idle_query.tv_sec) * 1000L +
+                       (now.tv_nsec - last_idle_query.tv_nsec) / 1000000L;
+        if (idle > last_idle_time + elapsed + 5000L) {
+            daemon_log(LOG_LEVEL_WARNING, "Rejecting anomalous idle time %ld ms (was %ld ms %ld ms ago)", idle, last_idle_time, elapsed);
+            return -1;
+        }
+    }
+
+    last_idle_time = idle;
+    last_idle_query = now;
+    return idle;
+}
+
+/* Without X, the most recent access time of any login terminal stands in for user input. */
+int check_no_gui_user_activity(void) {
+    time_t now = time(NULL);
+    time_t last_input = 0;
+
+    setutxent();
+    struct utmpx *entry;
+    while ((entry = getutxent()) != NULL) {
+        if (entry->ut_type != USER_PROCESS) {
+            continue;
+        }
+
+        char tty_path[64];
+        snprintf(tty_path, sizeof(tty_path), "/dev/%.*s", (int)sizeof(entry->ut_line), entry->ut_line);
+        struct stat st;
+        if (stat(tty_path, &st) == 0 && st.st_atime > last_input) {
+            last_input = st.st_atime;
+        }
+    }
+    endutxent();
+
+    if (now - last_input < ms_to_s(inactivity_timeout)) {
+        daemon_log(LOG_LEVEL_DEBUG, "User activity detected based on TTY interaction.");
+        return 1;
+    }
+
+    daemon_log(LOG_LEVEL_DEBUG, "No user activity detected.");
+    return 0;
+}
+
+static void run_action_command(const char *command) {
+    daemon_log_flush();
+    pid_t pid = fork();
+    if (pid == -1) {
+        daemon_log(LOG_LEVEL_ERROR, "Failed to fork action command: %s", strerror(errno));
+        return;
+    }
+
+    if (pid == 0) {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigprocmask(SIG_SETMASK, &signals, NULL);
+        setpgid(0, 0);
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        _exit(EXIT_FAILURE);
+    }
+
+    setpgid(pid, pid);
+    if (!supervise_child_process(pid)) {
+        int status;
+        waitpid(pid, &status, 0);
+        log_child_exit(status);
+    }
+}
+
+void perform_action(int gui) {
+    if (child_process_count > 0) {
+        daemon_log(LOG_LEVEL_WARNING, "Previous action command (PID %d) is still running. No action taken.", (int)child_processes[0].pid);
+        return;
+    }
+    iteration_record.flags |= SAMPLE_FLAG_ACTION;
+    if (!gui) {
+        if (strlen(custom_no_gui_command) > 0) {
+            daemon_log(LOG_LEVEL_INFO, "Executing Custom No X Server Command: %s", custom_no_gui_command);
+            run_action_command(custom_no_gui_command);
+        } else {
+            daemon_log(LOG_LEVEL_WARNING, "Warning: No custom command defined for no-X-server environment. No action taken.");
+        }
+    } else if (action_type == DEFAULT_ACTION_TYPE_SLEEP) {
+        if (strlen(sleep_command) > 0) {
+            daemon_log(LOG_LEVEL_INFO, "Executing GUI Sleep Command: %s", sleep_command);
+            run_action_command(sleep_command);
+        } else {
+            daemon_log(LOG_LEVEL_WARNING, "Warning: No sleep command defined for X-server environment. No action taken.");
+        }
+    } else {
+        if (strlen(shutdown_command) > 0) {
+            daemon_log(LOG_LEVEL_INFO, "Executing GUI Shutdown Command: %s", shutdown_command);
+            run_action_command(shutdown_command);
+        } else {
+            daemon_log(LOG_LEVEL_WARNING, "Warning: No shutdown command defined for X-server environment. No action taken.");
+        }
+    }
+}
+
+/* Runs one decision and returns how long to wait, at most, before the next one. */
+/* Set when the iteration only started collecting data; it is run again, and recorded, once that is in. */
+static int decision_deferred = 0;
+
+/* How long a deferred decision waits: to the end of a counter measurement, or one sample for the window. */
+static int deferred_decision_wait(void) {
+    decision_deferred = 1;
+    if (measurement_due_ms != 0) {
+        long long remaining = measurement_due_ms - monotonic_ms();
+        return remaining > 0 ? (int)((remaining + 999) / 1000) : 1;
+    }
+    return sample_interval;
+}
+
+int daemon_iteration(void) {
+    daemon_log(LOG_LEVEL_DEBUG, "Starting main loop iteration.");
+    begin_sample_record();
+    next_decision_ms = 0;
+    decision_deferred = 0;
+    decision_waits_for_sample = 0;
+    if (is_system_booting()) {
+        iteration_record.flags |= SAMPLE_FLAG_BOOTING;
+        daemon_log(LOG_LEVEL_DEBUG, "System is booting, skipping activity check this iteration");
+        long remaining = (long)boot_grace_period * 60 - read_uptime_seconds();
+        return remaining > 0 && remaining < check_interval ? (int)remaining : check_interval;
+    }
+
+    if (check_gui()) {
+        daemon_log(LOG_LEVEL_DEBUG, "X server detected. Using standard logic.");
+        iteration_record.flags |= SAMPLE_FLAG_GUI;
+        long user_inactive_time = query_user_idle_time();
+        if (user_inactive_time < 0) {
+            daemon_log(LOG_LEVEL_DEBUG, "X idle time query returned no data, skipping iteration");
+            return check_interval;
+        }
+        daemon_log(LOG_LEVEL_DEBUG, "X idle time query returned: %ld", user_inactive_time);
+        iteration_record.idle_ms = user_inactive_time > INT32_MAX ? INT32_MAX : (int32_t)user_inactive_time;
+
+        int timeout;
+        if (check_long_running_apps_active()) {
+            iteration_record.flags |= SAMPLE_FLAG_LONG_RUNNING;
+            timeout = long_running_apps_timeout;
+            daemon_log(LOG_LEVEL_DEBUG, "Long-running apps active. Using extended timeout: %d seconds", ms_to_s(timeout));
+        } else {
+            timeout = inactivity_timeout;
+            daemon_log(LOG_LEVEL_DEBUG, "No long-running apps active. Using standard timeout: %d seconds", ms_to_s(timeout));
+        }
+        status_timeout_ms = timeout;
+        status_long_running = (iteration_record.flags & SAMPLE_FLAG_LONG_RUNNING) != 0;
+
+        daemon_log(LOG_LEVEL_DEBUG, "User inactive time: %.2f seconds (current timeout: %d seconds).",
+                   user_inactive_time / 1000.0, ms_to_s(timeout));
+
+        if (user_inactive_time < timeout) {
+            daemon_log(LOG_LEVEL_DEBUG, "User activity detected (screen active). Skipping system activity check.");
+            iteration_record.flags |= SAMPLE_FLAG_USER_ACTIVE;
+            int shortest_timeout = inactivity_timeout < long_running_apps_timeout ? inactivity_timeout : long_running_apps_timeout;
+            long alarm_at = user_inactive_time < shortest_timeout ? shortest_timeout : timeout;
+            arm_idle_alarm(alarm_at, 0);
+            schedule_next_decision(alarm_at - user_inactive_time);
+            return check_interval;
+        }
+
+        int active = check_system_activity();
+        if (active == 0) {
+            daemon_log(LOG_LEVEL_INFO, "Inactivity timeout reached and no system activity detected. Initiating X-server action.");
+            perform_action(1);
+        } else if (active > 0) {
+            daemon_log(LOG_LEVEL_INFO, "System activity detected despite user inactivity. Continuing to monitor.");
+        }
+        arm_idle_alarm(user_inactive_time / 2, 1);
+        if (active == ACTIVITY_CHECK_PENDING) {
+            return deferred_decision_wait();
+        }
+    } else {
+        daemon_log(LOG_LEVEL_DEBUG, "No X server detected. Using no-X-server user activity check.");
+        status_timeout_ms = inactivity_timeout;
+        status_long_running = 0;
+        if (check_no_gui_user_activity()) {
+            daemon_log(LOG_LEVEL_DEBUG, "User activity detected in no-X-server environment. Resetting timer.");
+            iteration_record.flags |= SAMPLE_FLAG_USER_ACTIVE;
+        } else {
+            int active = check_system_activity();
+            if (active == 0) {
+                daemon_log(LOG_LEVEL_INFO, "No user activity and no system activity detected in no-X-server environment. Initiating no-X-server action.");
+                perform_action(0);
+            } else if (active > 0) {
+                daemon_log(LOG_LEVEL_INFO, "System activity detected in no-X-server environment. Continuing to monitor.");
+            } else {
+                return deferred_decision_wait();
+            }
+        }
+    }
+    return check_interval;
+}
+
+static void copy_daemon_string_option(char *dest, size_t size, const char *value) {
+    strncpy(dest, value, size - 1);
+    dest[size - 1] = '\0';
+}
+
+static int parse_daemon_options(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char *option = argv[i];
+        if (strcmp(option, "--daemon") == 0) {
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for parameter: %s\n", option);
+            return 0;
+        }
+        const char *value = argv[++i];
+
+        if (strcmp(option, "--home") == 0) {
+            continue;
+        } else if (strcmp(option, "--inactivity-timeout") == 0) {
+            inactivity_timeout = atoi(value);
+        } else if (strcmp(option, "--long-running-apps-timeout") == 0) {
+            long_running_apps_timeout = atoi(value);
+        } else if (strcmp(option, "--custom-long-running-apps") == 0) {
+            copy_daemon_string_option(custom_long_running_apps, sizeof(custom_long_running_apps), value);
+        } else if (strcmp(option, "--check-interval") == 0) {
+            check_interval = atoi(value);
+        } else if (strcmp(option, "--cpu-threshold") == 0) {
+            cpu_threshold = atoi(value);
+        } else if (strcmp(option, "--io-threshold") == 0) {
+            io_threshold = atoi(value);
+        } else if (strcmp(option, "--net-threshold") == 0) {
+            net_threshold = atoi(value);
+        } else if (strcmp(option, "--cpu-exit-threshold") == 0) {
+            cpu_exit_threshold = atoi(value);
+        } else if (strcmp(option, "--io-exit-threshold") == 0) {
+            io_exit_threshold = atoi(value);
+        } else if (strcmp(option, "--net-exit-threshold") == 0) {
+            net_exit_threshold = atoi(value);
+        } else if (strcmp(option, "--ewma-weight") == 0) {
+            ewma_weight = atoi(value);
+        } else if (strcmp(option, "--cgroup-cpu-threshold") == 0) {
+            cgroup_cpu_threshold = atoi(value);
+        } else if (strcmp(option, "--cgroup-io-threshold") == 0) {
+            cgroup_io_threshold = atoi(value);
+        } else if (strcmp(option, "--activity-source") == 0) {
+            activity_source = atoi(value);
+        } else if (strcmp(option, "--psi-cpu-threshold") == 0) {
+            psi_cpu_threshold = atoi(value);
+        } else if (strcmp(option, "--psi-io-threshold") == 0) {
+            psi_io_threshold = atoi(value);
+        } else if (strcmp(option, "--psi-average") == 0) {
+            psi_average = atoi(value);
+        } else if (strcmp(option, "--psi-trigger-ms") == 0) {
+            psi_trigger_ms = atoi(value);
+        } else if (strcmp(option, "--min-dwell-time") == 0) {
+            min_dwell_time = atoi(value);
+        } else if (strcmp(option, "--cpu-net-check-interval") == 0) {
+            cpu_net_check_interval = atoi(value);
+        } else if (strcmp(option, "--io-check-interval") == 0) {
+            io_check_interval = atoi(value);
+        } else if (strcmp(option, "--boot-grace-period") == 0 || strcmp(option, "--boot_grace_period") == 0) {
+            boot_grace_period = atoi(value);
+        } else if (strcmp(option, "--action-type") == 0) {
+            action_type = atoi(value);
+        } else if (strcmp(option, "--cpu-policy") == 0) {
+            cpu_policy = atoi(value);
+        } else if (strcmp(option, "--log-level") == 0) {
+            log_level = atoi(value);
+        } else if (strcmp(option, "--activity-window") == 0) {
+            activity_window = atoi(value);
+        } else if (strcmp(option, "--sample-interval") == 0) {
+            sample_interval = atoi(value);
+        } else if (strcmp(option, "--activity-statistic") == 0) {
+            activity_statistic = atoi(value);
+        } else if (strcmp(option, "--activity-busy-percent") == 0) {
+            activity_busy_percent = atoi(value);
+        } else if (strcmp(option, "--cpu-top-cores") == 0) {
+            cpu_top_cores = atoi(value);
+        } else if (strcmp(option, "--io-devices-include") == 0) {
+            copy_daemon_string_option(io_devices_include, sizeof(io_devices_include), value);
+        } else if (strcmp(option, "--io-devices-exclude") == 0) {
+            copy_daemon_string_option(io_devices_exclude, sizeof(io_devices_exclude), value);
+        } else if (strcmp(option, "--net-interfaces-include") == 0) {
+            copy_daemon_string_option(net_interfaces_include, sizeof(net_interfaces_include), value);
+        } else if (strcmp(option, "--net-interfaces-exclude") == 0) {
+            copy_daemon_string_option(net_interfaces_exclude, sizeof(net_interfaces_exclude), value);
+        } else if (strcmp(option, "--net-kinds-exclude") == 0) {
+            copy_daemon_string_option(net_kinds_exclude, sizeof(net_kinds_exclude), value);
+        } else if (strcmp(option, "--activity-denylist") == 0) {
+            copy_daemon_string_option(activity_denylist, sizeof(activity_denylist), value);
+        } else if (strcmp(option, "--activity-allowlist") == 0) {
+            copy_daemon_string_option(activity_allowlist, sizeof(activity_allowlist), value);
+        } else if (strcmp(option, "--cgroups-include") == 0) {
+            copy_daemon_string_option(cgroups_include, sizeof(cgroups_include), value);
+        } else if (strcmp(option, "--cgroups-exclude") == 0) {
+            copy_daemon_string_option(cgroups_exclude, sizeof(cgroups_exclude), value);
+        } else if (strcmp(option, "--sleep-command") == 0) {
+            copy_daemon_string_option(sleep_command, sizeof(sleep_command), value);
+        } else if (strcmp(option, "--shutdown-command") == 0) {
+            copy_daemon_string_option(shutdown_command, sizeof(shutdown_command), value);
+        } else if (strcmp(option, "--custom-no-gui-command") == 0) {
+            copy_daemon_string_option(custom_no_gui_command, sizeof(custom_no_gui_command), value);
+        } else {
+            fprintf(stderr, "Unknown parameter: %s\n", option);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Everything a reload may change, so a rejected config.ini can be rolled back. */
+#define DAEMON_INT_SETTINGS(X) \
+    X(inactivity_timeout) X(long_running_apps_timeout) X(check_interval) X(cpu_threshold) \
+    X(io_threshold) X(net_threshold) X(cpu_exit_threshold) X(io_exit_threshold) X(net_exit_threshold) \
+    X(ewma_weight) X(min_dwell_time) X(cpu_net_check_interval) X(io_check_interval) X(boot_grace_period) \
+    X(action_type) X(cpu_policy) X(cpu_top_cores) X(log_level) X(activity_window) X(sample_interval) \
+    X(activity_statistic) X(activity_busy_percent) X(cgroup_cpu_threshold) X(cgroup_io_threshold) \
+    X(activity_source) X(psi_cpu_threshold) X(psi_io_threshold) X(psi_average) X(psi_trigger_ms)
+#define DAEMON_STRING_SETTINGS(X) \
+    X(custom_long_running_apps) X(sleep_command) X(shutdown_command) X(custom_no_gui_command) \
+    X(io_devices_include) X(io_devices_exclude) X(net_interfaces_include) X(net_interfaces_exclude) \
+    X(net_kinds_exclude) X(activity_denylist) X(activity_allowlist) X(cgroups_include) X(cgroups_exclude)
+
+struct daemon_settings {
+#define DECLARE_INT_SETTING(name) int name;
+#define DECLARE_STRING_SETTING(name) char name[MAX_COMMAND_LENGTH];
+    DAEMON_INT_SETTINGS(DECLARE_INT_SETTING)
+    DAEMON_STRING_SETTINGS(DECLARE_STRING_SETTING)
+#undef DECLARE_INT_SETTING
+#undef DECLARE_STRING_SETTING
+};
+
+static void store_daemon_settings(struct daemon_settings *settings) {
+#define STORE_INT_SETTING(name) settings->name = name;
+#define STORE_STRING_SETTING(name) memcpy(settings->name, name, sizeof(settings->name));
+    DAEMON_INT_SETTINGS(STORE_INT_SETTING)
+    DAEMON_STRING_SETTINGS(STORE_STRING_SETTING)
+#undef STORE_INT_SETTING
+#undef STORE_STRING_SETTING
+}
+
+static void restore_daemon_settings(const struct daemon_settings *settings) {
+#define RESTORE_INT_SETTING(name) name = settings->name;
+#define RESTORE_STRING_SETTING(name) memcpy(name, settings->name, sizeof(settings->name));
+    DAEMON_INT_SETTINGS(RESTORE_INT_SETTING)
+    DAEMON_STRING_SETTINGS(RESTORE_STRING_SETTING)
+#undef RESTORE_INT_SETTING
+#undef RESTORE_STRING_SETTING
+}
+
+/* The same limits the settings window enforces, for values edited into config.ini by hand. */
+static int validate_daemon_settings(char *error, size_t error_size) {
+    const char *invalid = NULL;
+    if (inactivity_timeout < 1000) invalid = "inactivity_timeout";
+    else if (long_running_apps_timeout < 1000) invalid = "long_running_apps_timeout";
+    else if (check_interval < 1) invalid = "check_interval";
+    else if (cpu_net_check_interval < 1) invalid = "cpu_net_check_interval";
+    else if (io_check_interval < 1) invalid = "io_check_interval";
+    else if (cpu_threshold < 0 || cpu_threshold > 100) invalid = "cpu_threshold";
+    else if (cpu_exit_threshold < 0 || cpu_exit_threshold > 100) invalid = "cpu_exit_threshold";
+    else if (io_threshold < 0 || io_exit_threshold < 0) invalid = "io_threshold";
+    else if (net_threshold < 0 || net_exit_threshold < 0) invalid = "net_threshold";
+    else if (cgroup_cpu_threshold < 0 || cgroup_cpu_threshold > 100) invalid = "cgroup_cpu_threshold";
+    else if (cgroup_io_threshold < 0) invalid = "cgroup_io_threshold";
+    else if (activity_source != ACTIVITY_SOURCE_COUNTERS && activity_source != ACTIVITY_SOURCE_PSI) invalid = "activity_source";
+    else if (psi_cpu_threshold < 0 || psi_cpu_threshold > 100) invalid = "psi_cpu_threshold";
+    else if (psi_io_threshold < 0 || psi_io_threshold > 100) invalid = "psi_io_threshold";
+    else if (psi_average != 10 && psi_average != 60 && psi_average != 300) invalid = "psi_average";
+    else if (psi_trigger_ms < 0 || psi_trigger_ms >= PSI_TRIGGER_WINDOW_MS) invalid = "psi_trigger_ms";
+    else if (ewma_weight < 1 || ewma_weight > 100) invalid = "ewma_weight";
+    else if (min_dwell_time < 0) invalid = "min_dwell_time";
+    else if (boot_grace_period < 0 || boot_grace_period > 525600) invalid = "boot_grace_period";
+    else if (action_type != DEFAULT_ACTION_TYPE_SLEEP && action_type != DEFAULT_ACTION_TYPE_SHUTDOWN) invalid = "action_type";
+    else if (cpu_policy < CPU_POLICY_AGGREGATE || cpu_policy > CPU_POLICY_TOP_CORES) invalid = "cpu_policy";
+    else if (cpu_top_cores < 1) invalid = "cpu_top_cores";
+    else if (log_level < LOG_LEVEL_ERROR || log_level > LOG_LEVEL_DEBUG) invalid = "log_level";
+    else if (activity_window < 0) invalid = "activity_window";
+    else if (sample_interval < 1) invalid = "sample_interval";
+    else if (activity_statistic < ACTIVITY_STATISTIC_AVERAGE || activity_statistic > ACTIVITY_STATISTIC_P95) invalid = "activity_statistic";
+    else if (activity_busy_percent < 0 || activity_busy_percent > 100) invalid = "activity_busy_percent";
+    else if (!validate_script_command(sleep_command)) invalid = "sleep_command";
+    else if (!validate_script_command(shutdown_command)) invalid = "shutdown_command";
+    else if (!validate_script_command(custom_no_gui_command)) invalid = "custom_no_gui_command";
+
+    if (invalid != NULL) {
+        snprintf(error, error_size, "invalid value for %s", invalid);
+        return 0;
+    }
+    return 1;
+}
+
+static int daemon_argc = 0;
+static char **daemon_argv = NULL;
+
+static struct stat loaded_config_stat;
+
+/* Remembers which config.ini was read last, so the inotify event and a "reload" for one save are applied once. */
+static int config_file_changed(void) {
+    char path[MAX_PATH_LENGTH];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/.XorgIdleManager/config.ini", getenv("HOME"));
+    if (stat(path, &st) == -1) {
+        memset(&st, 0, sizeof(st));
+    }
+    int changed = st.st_ino != loaded_config_stat.st_ino || st.st_size != loaded_config_stat.st_size ||
+                  st.st_mtim.tv_sec != loaded_config_stat.st_mtim.tv_sec ||
+                  st.st_mtim.tv_nsec != loaded_config_stat.st_mtim.tv_nsec;
+    loaded_config_stat = st;
+    return changed;
+}
+
+/*
+ * Re-reads config.ini (command-line options still take precedence) and swaps the new values in.
+ * Sample history, engine state and timers are kept; the activity window is only rebuilt when
+ * its length changes, and device tables only when their filters do. Unless forced, an unchanged
+ * file is not read again and the previous outcome stands.
+ */
+static int reload_daemon_config(int force) {
+    static struct daemon_settings previous;
+    struct app_matcher matcher;
+
+    if (!config_file_changed() && !force) {
+        return 0;
+    }
+    store_daemon_settings(&previous);
+    read_config();
+    parse_daemon_options(daemon_argc, daemon_argv);
+    last_reload_ok = validate_daemon_settings(last_reload_error, sizeof(last_reload_error)) &&
+                     compile_app_matcher(&matcher, custom_long_running_apps, last_reload_error, sizeof(last_reload_error));
+    if (last_reload_ok && (strcmp(previous.activity_denylist, activity_denylist) != 0 ||
+                           strcmp(previous.activity_allowlist, activity_allowlist) != 0)) {
+        last_reload_ok = compile_activity_lists(last_reload_error, sizeof(last_reload_error));
+        if (!last_reload_ok) {
+            free_app_matcher(&matcher);
+        } else {
+            sampler_rebase = 1;
+        }
+    }
+    if (!last_reload_ok) {
+        restore_daemon_settings(&previous);
+        daemon_log(LOG_LEVEL_WARNING, "Rejected config.ini (%s), keeping the running settings", last_reload_error);
+        return 0;
+    }
+
+    int matcher_was_valid = long_running_apps_matcher_valid;
+    free_app_matcher(&long_running_apps_matcher);
+    long_running_apps_matcher = matcher;
+    long_running_apps_matcher_valid = 1;
+    if (!matcher_was_valid) {
+        init_process_tracker();
+        watch_event_source(proc_connector_fd, EVENT_PROC_CONNECTOR);
+    } else if (strcmp(previous.custom_long_running_apps, custom_long_running_apps) != 0) {
+        rescan_long_running_apps();
+    }
+
+    if (strcmp(previous.io_devices_include, io_devices_include) != 0 ||
+        strcmp(previous.io_devices_exclude, io_devices_exclude) != 0) {
+        reset_disk_devices();
+        sampler_rebase = 1;
+    }
+    if (strcmp(previous.net_interfaces_include, net_interfaces_include) != 0 ||
+        strcmp(previous.net_interfaces_exclude, net_interfaces_exclude) != 0 ||
+        strcmp(previous.net_kinds_exclude, net_kinds_exclude) != 0) {
+        reset_net_interfaces();
+        sampler_rebase = 1;
+    }
+    if (strcmp(previous.cgroups_include, cgroups_include) != 0 ||
+        strcmp(previous.cgroups_exclude, cgroups_exclude) != 0) {
+        reset_cgroup_files();
+        sampler_rebase = 1;
+    }
+    if (previous.activity_window != activity_window || previous.sample_interval != sample_interval) {
+        reset_activity_window();
+        sampler_rebase = 1;
+    }
+    if (previous.activity_window != activity_window || previous.activity_statistic != activity_statistic ||
+        previous.activity_busy_percent != activity_busy_percent || previous.cpu_policy != cpu_policy ||
+        previous.cpu_top_cores != cpu_top_cores) {
+        /* The smoothed values were taken of a different measure. */
+        reset_activity_engine();
+    }
+    if (previous.activity_source != activity_source) {
+        open_pressure_files();
+    }
+    if (previous.activity_source != activity_source || previous.psi_average != psi_average) {
+        /* Pressure percentages and counter rates do not mix in one smoothed value. */
+        reset_activity_window();
+        reset_activity_engine();
+        sampler_rebase = 1;
+    }
+    if (previous.activity_source != activity_source || previous.psi_trigger_ms != psi_trigger_ms) {
+        open_pressure_triggers();
+    }
+
+    daemon_log(LOG_LEVEL_INFO, "Reloaded config.ini");
+    status_changed = 1;
+    return 1;
+}
+
+int run_daemon(int argc, char *argv[]) {
+    daemon_mode = 1;
+    daemon_argc = argc;
+    daemon_argv = argv;
+
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--home") == 0) {
+            setenv("HOME", argv[i + 1], 1);
+        }
+    }
+    if (getenv("HOME") == NULL) {
+        fprintf(stderr, "Environment variable HOME is not defined.\n");
+        return EXIT_FAILURE;
+    }
+
+    read_config();
+    config_file_changed();
+    if (!parse_daemon_options(argc, argv)) {
+        return EXIT_FAILURE;
+    }
+
+    snprintf(daemon_log_path, sizeof(daemon_log_path), "%s/.XorgIdleManager/xorg-idle-manager.log", getenv("HOME"));
+
+    /* The values a reload would reject are not run at startup either. */
+    if (!validate_daemon_settings(last_reload_error, sizeof(last_reload_error))) {
+        fprintf(stderr, "Rejected config.ini: %s\n", last_reload_error);
+        daemon_log(LOG_LEVEL_ERROR, "Rejected config.ini (%s), not starting", last_reload_error);
+        close_daemon_log();
+        return EXIT_FAILURE;
+    }
+    daemon_log(LOG_LEVEL_INFO, "=== Daemon started (PID %d) ===", (int)getpid());
+
+    display_from_environment = getenv("DISPLAY") != NULL;
+    XSetErrorHandler(handle_x_error);
+    XSetIOErrorHandler(handle_x_io_error);
+
+    /* Binding the control socket name is the single-instance check, so it comes first. */
+    if (!init_event_loop() || !open_control_socket()) {
+        close_event_loop();
+        close_daemon_log();
+        return EXIT_FAILURE;
+    }
+    daemon_start_time = time(NULL);
+
+    char matcher_error[MAX_ERROR_LENGTH];
+    long_running_apps_matcher_valid = compile_app_matcher(&long_running_apps_matcher, custom_long_running_apps,
+                                                          matcher_error, sizeof(matcher_error));
+    if (!long_running_apps_matcher_valid) {
+        daemon_log(LOG_LEVEL_ERROR, "Invalid custom long-running apps list: %s", matcher_error);
+    }
+    init_process_tracker();
+    watch_event_source(proc_connector_fd, EVENT_PROC_CONNECTOR);
+    if (!compile_activity_lists(matcher_error, sizeof(matcher_error))) {
+        daemon_log(LOG_LEVEL_ERROR, "Invalid process attribution list, counting every process: %s", matcher_error);
+    }
+    open_pressure_files();
+    open_pressure_triggers();
+
+    open_sample_ring();
+    daemon_log(LOG_LEVEL_INFO, "Entering main loop");
+    while (!daemon_stop_requested) {
+        int wait_seconds = daemon_iteration();
+        if (!decision_deferred) {
+            append_sample_record();
+        }
+        status_changed = 1;
+        schedule_next_decision((long long)wait_seconds * 1000);
+        if (daemon_stop_requested) {
+            break;
+        }
+        daemon_log(LOG_LEVEL_DEBUG, "Waiting for idle alarm or at most %d seconds.", wait_seconds);
+        daemon_log_flush();
+        wait_for_idle_event(wait_seconds);
+        daemon_log(LOG_LEVEL_DEBUG, "End of loop iteration.");
+    }
+
+    stop_child_processes();
+    daemon_log(LOG_LEVEL_INFO, "Daemon stopped.");
+    close_idle_display();
+    close_process_tracker();
+    close_process_attribution();
+    close_cgroup_files();
+    close_pressure_triggers();
+    close_pressure_files();
+    free_app_matcher(&long_running_apps_matcher);
+    close_sample_ring();
+    close_event_loop();
+    close_daemon_log();
+    return EXIT_SUCCESS;
+}
+
+void set_tooltip(GtkWidget *widget, const char *text) {
+    gtk_widget_set_tooltip_text(widget, text);
+}
+
+GtkWidget *create_label_with_tooltip(const char *label_text, const char *tooltip_text) {
+    GtkWidget *label = gtk_label_new(label_text);
+    gtk_widget_set_halign(label, GTK_ALIGN_START);
+    gtk_widget_set_tooltip_text(label, tooltip_text);
+    return label;
+}
+
+void update_ui_values(void) {
+    char buffer[20];
+    snprintf(buffer, sizeof(buffer), "%d", ms_to_s(inactivity_timeout));
+    gtk_entry_set_text(GTK_ENTRY(inactivity_timeout_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", ms_to_s(long_running_apps_timeout));
+    gtk_entry_set_text(GTK_ENTRY(long_running_apps_timeout_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", check_interval);
+    gtk_entry_set_text(GTK_ENTRY(check_interval_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", cpu_threshold);
+    gtk_entry_set_text(GTK_ENTRY(cpu_threshold_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", io_threshold);
+    gtk_entry_set_text(GTK_ENTRY(io_threshold_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", net_threshold);
+    gtk_entry_set_text(GTK_ENTRY(net_threshold_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", cpu_exit_threshold);
+    gtk_entry_set_text(GTK_ENTRY(cpu_exit_threshold_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", io_exit_threshold);
+    gtk_entry_set_text(GTK_ENTRY(io_exit_threshold_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", net_exit_threshold);
+    gtk_entry_set_text(GTK_ENTRY(net_exit_threshold_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", ewma_weight);
+    gtk_entry_set_text(GTK_ENTRY(ewma_weight_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", min_dwell_time);
+    gtk_entry_set_text(GTK_ENTRY(min_dwell_time_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", cpu_net_check_interval);
+    gtk_entry_set_text(GTK_ENTRY(cpu_net_check_interval_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", io_check_interval);
+    gtk_entry_set_text(GTK_ENTRY(io_check_interval_entry), buffer);
+
+    snprintf(buffer, sizeof(buffer), "%d", boot_grace_period);
+    gtk_entry_set_text(GTK_ENTRY(boot_grace_period_entry), buffer);
+
+    gtk_combo_box_set_active(GTK_COMBO_BOX(action_combo_box), action_type);
+
+    gtk_entry_set_text(GTK_ENTRY(custom_long_running_apps_entry), custom_long_running_apps);
+    gtk_entry_set_text(GTK_ENTRY(sleep_command_entry), sleep_command);
+    gtk_entry_set_text(GTK_ENTRY(shutdown_command_entry), shutdown_command);
+    gtk_entry_set_text(GTK_ENTRY(custom_no_gui_command_entry), custom_no_gui_command);
+
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(dpms_enabled_check), dpms_enabled);
+    
+    snprintf(buffer, sizeof(buffer), "%d", dpms_standby);
+    gtk_entry_set_text(GTK_ENTRY(dpms_standby_entry), buffer);
+    
+    snprintf(buffer, sizeof(buffer), "%d", dpms_suspend);
+    gtk_entry_set_text(GTK_ENTRY(dpms_suspend_entry), buffer);
+    
+    snprintf(buffer, sizeof(buffer), "%d", dpms_off);
+    gtk_entry_set_text(GTK_ENTRY(dpms_off_entry), buffer);
+}
+
+void restore_defaults_sleep(GtkWidget *widget, gpointer data) {
+    inactivity_timeout = DEFAULT_INACTIVITY_TIMEOUT_SLEEP;
+    long_running_apps_timeout = DEFAULT_LONG_RUNNING_APPS_TIMEOUT_SLEEP;
+    check_interval = DEFAULT_CHECK_INTERVAL;
+    cpu_threshold = DEFAULT_CPU_THRESHOLD;
+    io_threshold = DEFAULT_IO_THRESHOLD;
+    net_threshold = DEFAULT_NET_THRESHOLD;
+    cpu_exit_threshold = DEFAULT_CPU_EXIT_THRESHOLD;
+    io_exit_threshold = DEFAULT_IO_EXIT_THRESHOLD;
+    net_exit_threshold = DEFAULT_NET_EXIT_THRESHOLD;
+    ewma_weight = DEFAULT_EWMA_WEIGHT;
+    min_dwell_time = DEFAULT_MIN_DWELL_TIME;
+    cgroup_cpu_threshold = DEFAULT_CGROUP_CPU_THRESHOLD;
+    cgroup_io_threshold = DEFAULT_CGROUP_IO_THRESHOLD;
+    activity_source = DEFAULT_ACTIVITY_SOURCE;
+    psi_cpu_threshold = DEFAULT_PSI_CPU_THRESHOLD;
+    psi_io_threshold = DEFAULT_PSI_IO_THRESHOLD;
+    psi_average = DEFAULT_PSI_AVERAGE;
+    psi_trigger_ms = DEFAULT_PSI_TRIGGER_MS;
+    cpu_net_check_interval = DEFAULT_CPU_NET_CHECK_INTERVAL;
+    io_check_interval = DEFAULT_IO_CHECK_INTERVAL;
+    cpu_policy = DEFAULT_CPU_POLICY;
+    cpu_top_cores = DEFAULT_CPU_TOP_CORES;
+    activity_window = DEFAULT_ACTIVITY_WINDOW;
+    sample_interval = DEFAULT_SAMPLE_INTERVAL;
+    activity_statistic = DEFAULT_ACTIVITY_STATISTIC;
+    activity_busy_percent = DEFAULT_ACTIVITY_BUSY_PERCENT;
+    action_type = DEFAULT_ACTION_TYPE_SLEEP;
+
+    strncpy(custom_long_running_apps, DEFAULT_CUSTOM_LONG_RUNNING_APPS, sizeof(custom_long_running_apps) - 1);
+    strncpy(sleep_command, DEFAULT_SLEEP_COMMAND, sizeof(sleep_command) - 1);
+    custom_long_running_apps[sizeof(custom_long_running_apps) - 1] = '\0';
+    sleep_command[sizeof(sleep_command) - 1] = '\0';
+
+    update_ui_values();
+}
+
+void restore_defaults_shutdown(GtkWidget *widget, gpointer data) {
+    inactivity_timeout = DEFAULT_INACTIVITY_TIMEOUT_SHUTDOWN;
+    long_running_apps_timeout = DEFAULT_LONG_RUNNING_APPS_TIMEOUT_SHUTDOWN;
+    check_interval = DEFAULT_CHECK_INTERVAL;
+    cpu_threshold = DEFAULT_CPU_THRESHOLD;
+    io_threshold = DEFAULT_IO_THRESHOLD;
+    net_threshold = DEFAULT_NET_THRESHOLD;
+    cpu_exit_threshold = DEFAULT_CPU_EXIT_THRESHOLD;
+    io_exit_threshold = DEFAULT_IO_EXIT_THRESHOLD;
+    net_exit_threshold = DEFAULT_NET_EXIT_THRESHOLD;
+    ewma_weight = DEFAULT_EWMA_WEIGHT;
+    min_dwell_time = DEFAULT_MIN_DWELL_TIME;
+    cgroup_cpu_threshold = DEFAULT_CGROUP_CPU_THRESHOLD;
+    cgroup_io_threshold = DEFAULT_CGROUP_IO_THRESHOLD;
+    activity_source = DEFAULT_ACTIVITY_SOURCE;
+    psi_cpu_threshold = DEFAULT_PSI_CPU_THRESHOLD;
+    psi_io_threshold = DEFAULT_PSI_IO_THRESHOLD;
+    psi_average = DEFAULT_PSI_AVERAGE;
+    psi_trigger_ms = DEFAULT_PSI_TRIGGER_MS;
+    cpu_net_check_interval = DEFAULT_CPU_NET_CHECK_INTERVAL;
+    io_check_interval = DEFAULT_IO_CHECK_INTERVAL;
+    cpu_policy = DEFAULT_CPU_POLICY;
+    cpu_top_cores = DEFAULT_CPU_TOP_CORES;
+    activity_window = DEFAULT_ACTIVITY_WINDOW;
+    sample_interval = DEFAULT_SAMPLE_INTERVAL;
+    activity_statistic = DEFAULT_ACTIVITY_STATISTIC;
+    activity_busy_percent = DEFAULT_ACTIVITY_BUSY_PERCENT;
+    action_type = DEFAULT_ACTION_TYPE_SHUTDOWN;
+
+    strncpy(custom_long_running_apps, DEFAULT_CUSTOM_LONG_RUNNING_APPS, sizeof(custom_long_running_apps) - 1);
+    strncpy(shutdown_command, DEFAULT_SHUTDOWN_COMMAND, sizeof(shutdown_command) - 1);
+    custom_long_running_apps[sizeof(custom_long_running_apps) - 1] = '\0';
+    shutdown_command[sizeof(shutdown_command) - 1] = '\0';
+
+    update_ui_values();
+}
+
+void restore_defaults_custom_no_gui(GtkWidget *widget, gpointer data) {
+    inactivity_timeout = DEFAULT_INACTIVITY_TIMEOUT_NO_GUI;
+    long_running_apps_timeout = DEFAULT_LONG_RUNNING_APPS_TIMEOUT_NO_GUI;
+    check_interval = DEFAULT_CHECK_INTERVAL;
+    cpu_threshold = DEFAULT_CPU_THRESHOLD;
+    io_threshold = DEFAULT_IO_THRESHOLD;
+    net_threshold = DEFAULT_NET_THRESHOLD;
+    cpu_exit_threshold = DEFAULT_CPU_EXIT_THRESHOLD;
+    io_exit_threshold = DEFAULT_IO_EXIT_THRESHOLD;
+    net_exit_threshold = DEFAULT_NET_EXIT_THRESHOLD;
+    ewma_weight = DEFAULT_EWMA_WEIGHT;
+    min_dwell_time = DEFAULT_MIN_DWELL_TIME;
+    cgroup_cpu_threshold = DEFAULT_CGROUP_CPU_THRESHOLD;
+    cgroup_io_threshold = DEFAULT_CGROUP_IO_THRESHOLD;
+    activity_source = DEFAULT_ACTIVITY_SOURCE;
+    psi_cpu_threshold = DEFAULT_PSI_CPU_THRESHOLD;
+    psi_io_threshold = DEFAULT_PSI_IO_THRESHOLD;
+    psi_average = DEFAULT_PSI_AVERAGE;
+    psi_trigger_ms = DEFAULT_PSI_TRIGGER_MS;
+    cpu_net_check_interval = DEFAULT_CPU_NET_CHECK_INTERVAL;
+    io_check_interval = DEFAULT_IO_CHECK_INTERVAL;
+    cpu_policy = DEFAULT_CPU_POLICY;
+    cpu_top_cores = DEFAULT_CPU_TOP_CORES;
+    activity_window = DEFAULT_ACTIVITY_WINDOW;
+    sample_interval = DEFAULT_SAMPLE_INTERVAL;
+    activity_statistic = DEFAULT_ACTIVITY_STATISTIC;
+    activity_busy_percent = DEFAULT_ACTIVITY_BUSY_PERCENT;
+    action_type = DEFAULT_ACTION_TYPE_SHUTDOWN;
 
-        if (strlen(trimmed) > 0) {
-            if (strchr(trimmed, '|') || strchr(trimmed, '>') || strchr(trimmed, '<')) {
-                valid = 0;
-            }
-        }
-        token = strtok(NULL, ";");
-    }
+    strncpy(custom_long_running_apps, DEFAULT_CUSTOM_LONG_RUNNING_APPS, sizeof(custom_long_running_apps) - 1);
+    strncpy(custom_no_gui_command, DEFAULT_CUSTOM_NO_GUI_COMMAND, sizeof(custom_no_gui_command) - 1);
+    custom_long_running_apps[sizeof(custom_long_running_apps) - 1] = '\0';
+    custom_no_gui_command[sizeof(custom_no_gui_command) - 1] = '\0';
 
-    free(copy);
-    return valid;
+    update_ui_values();
 }
 
 void save_and_apply(GtkWidget *widget, gpointer data) {
@@ -528,6 +5341,11 @@ void save_and_apply(GtkWidget *widget, gpointer data) {
     const char *cpu_threshold_str = gtk_entry_get_text(GTK_ENTRY(cpu_threshold_entry));
     const char *io_threshold_str = gtk_entry_get_text(GTK_ENTRY(io_threshold_entry));
     const char *net_threshold_str = gtk_entry_get_text(GTK_ENTRY(net_threshold_entry));
+    const char *cpu_exit_threshold_str = gtk_entry_get_text(GTK_ENTRY(cpu_exit_threshold_entry));
+    const char *io_exit_threshold_str = gtk_entry_get_text(GTK_ENTRY(io_exit_threshold_entry));
+    const char *net_exit_threshold_str = gtk_entry_get_text(GTK_ENTRY(net_exit_threshold_entry));
+    const char *ewma_weight_str = gtk_entry_get_text(GTK_ENTRY(ewma_weight_entry));
+    const char *min_dwell_time_str = gtk_entry_get_text(GTK_ENTRY(min_dwell_time_entry));
     const char *cpu_net_check_interval_str = gtk_entry_get_text(GTK_ENTRY(cpu_net_check_interval_entry));
     const char *io_check_interval_str = gtk_entry_get_text(GTK_ENTRY(io_check_interval_entry));
     const char *boot_grace_period_str = gtk_entry_get_text(GTK_ENTRY(boot_grace_period_entry));
@@ -541,12 +5359,17 @@ void save_and_apply(GtkWidget *widget, gpointer data) {
         !validate_integer_input(cpu_threshold_str, 0, 100) ||
         !validate_integer_input(io_threshold_str, 0, INT_MAX) ||
         !validate_integer_input(net_threshold_str, 0, INT_MAX) ||
+        !validate_integer_input(cpu_exit_threshold_str, 0, 100) ||
+        !validate_integer_input(io_exit_threshold_str, 0, INT_MAX) ||
+        !validate_integer_input(net_exit_threshold_str, 0, INT_MAX) ||
+        !validate_integer_input(ewma_weight_str, 1, 100) ||
+        !validate_integer_input(min_dwell_time_str, 0, INT_MAX) ||
         !validate_integer_input(cpu_net_check_interval_str, 1, INT_MAX) ||
         !validate_integer_input(io_check_interval_str, 1, INT_MAX) ||
         !validate_integer_input(boot_grace_period_str, 1, 525600) ||
-        !validate_integer_input(dpms_standby_str, 0, INT_MAX) ||
-        !validate_integer_input(dpms_suspend_str, 0, INT_MAX) ||
-        !validate_integer_input(dpms_off_str, 0, INT_MAX)) {
+        !validate_integer_input(dpms_standby_str, 0, USHRT_MAX) ||
+        !validate_integer_input(dpms_suspend_str, 0, USHRT_MAX) ||
+        !validate_integer_input(dpms_off_str, 0, USHRT_MAX)) {
         show_error("Invalid input. Please check your values.");
         return;
     }
@@ -557,6 +5380,11 @@ void save_and_apply(GtkWidget *widget, gpointer data) {
     cpu_threshold = atoi(cpu_threshold_str);
     io_threshold = atoi(io_threshold_str);
     net_threshold = atoi(net_threshold_str);
+    cpu_exit_threshold = atoi(cpu_exit_threshold_str);
+    io_exit_threshold = atoi(io_exit_threshold_str);
+    net_exit_threshold = atoi(net_exit_threshold_str);
+    ewma_weight = atoi(ewma_weight_str);
+    min_dwell_time = atoi(min_dwell_time_str);
     cpu_net_check_interval = atoi(cpu_net_check_interval_str);
     io_check_interval = atoi(io_check_interval_str);
     boot_grace_period = atoi(boot_grace_period_str);
@@ -566,6 +5394,11 @@ void save_and_apply(GtkWidget *widget, gpointer data) {
     dpms_suspend = atoi(dpms_suspend_str);
     dpms_off = atoi(dpms_off_str);
 
+    if (dpms_enabled && !dpms_timeouts_ordered(dpms_standby, dpms_suspend, dpms_off)) {
+        show_error("Invalid DPMS timeouts. Non-zero values must not decrease from Standby to Suspend to Off.");
+        return;
+    }
+
     const char *sleep_cmd = gtk_entry_get_text(GTK_ENTRY(sleep_command_entry));
     const char *shutdown_cmd = gtk_entry_get_text(GTK_ENTRY(shutdown_command_entry));
     const char *custom_long_running_apps_text = gtk_entry_get_text(GTK_ENTRY(custom_long_running_apps_entry));
@@ -595,719 +5428,494 @@ void save_and_apply(GtkWidget *widget, gpointer data) {
         return;
     }
 
-    save_config();
+    struct app_matcher matcher;
+    char matcher_error[MAX_ERROR_LENGTH];
+    if (!compile_app_matcher(&matcher, custom_long_running_apps, matcher_error, sizeof(matcher_error))) {
+        char message[MAX_ERROR_LENGTH + 64];
+        snprintf(message, sizeof(message), "Invalid custom long-running applications: %s", matcher_error);
+        show_error(message);
+        return;
+    }
+    free_app_matcher(&matcher);
+
+    start_apply_job();
+}
+
+/*
+ * The status section subscribes to the daemon's control socket and is only redrawn when the
+ * daemon pushes a change. Between pushes a one-second timer advances the idle time and the
+ * countdown from the X server's idle counter on the window's own display; the daemon is not asked.
+ */
+static GIOChannel *status_channel = NULL;
+static guint status_countdown_source = 0;
+static int status_subscribe_attempts = 0;
+static char status_pending[CONTROL_STATUS_SIZE * 2];
+static size_t status_pending_length = 0;
+static int status_x_server = 0;
+static long status_shown_timeout_ms = 0;
+static long long status_next_decision_at = 0;
+
+static void format_duration(char *buffer, size_t size, long long ms) {
+    long long seconds = ms > 0 ? ms / 1000 : 0;
+    if (seconds >= 3600) {
+        snprintf(buffer, size, "%lld h %02lld min %02lld s", seconds / 3600, seconds / 60 % 60, seconds % 60);
+    } else if (seconds >= 60) {
+        snprintf(buffer, size, "%lld min %02lld s", seconds / 60, seconds % 60);
+    } else {
+        snprintf(buffer, size, "%lld s", seconds);
+    }
+}
 
-    if (dpms_enabled) {
-        char *dpms_on_argv[] = {"xset", "+dpms", NULL};
-        execute_command("xset", dpms_on_argv);
+static long query_window_idle_ms(void) {
+    static int extension_available = -1;
+    static XScreenSaverInfo *info = NULL;
 
-        char dpms_values[64];
-        snprintf(dpms_values, sizeof(dpms_values), "%d %d %d", dpms_standby, dpms_suspend, dpms_off);
+    Display *xdisplay = window_xdisplay();
+    if (xdisplay == NULL) {
+        return -1;
+    }
+    if (extension_available == -1) {
+        int event_base, error_base;
+        extension_available = XScreenSaverQueryExtension(xdisplay, &event_base, &error_base) &&
+                              (info = XScreenSaverAllocInfo()) != NULL;
+    }
+    if (!extension_available || !XScreenSaverQueryInfo(xdisplay, DefaultRootWindow(xdisplay), info)) {
+        return -1;
+    }
+    return (long)info->idle;
+}
 
-        char *dpms_set_argv[] = {"xset", "dpms", strdup(dpms_values), NULL};
-        execute_command("xset", dpms_set_argv);
-        free(dpms_set_argv[2]);
+static gboolean refresh_status_countdown(gpointer user_data) {
+    char duration[64];
+    char text[128];
+    long idle = status_x_server ? query_window_idle_ms() : -1;
+
+    if (idle >= 0) {
+        format_duration(duration, sizeof(duration), idle);
+        gtk_label_set_text(GTK_LABEL(status_idle_label), duration);
+        if (idle < status_shown_timeout_ms) {
+            format_duration(duration, sizeof(duration), status_shown_timeout_ms - idle);
+            snprintf(text, sizeof(text), "in %s", duration);
+        } else {
+            snprintf(text, sizeof(text), "due, waiting for system activity to settle");
+        }
     } else {
-        char *dpms_off_argv[] = {"xset", "-dpms", NULL};
-        execute_command("xset", dpms_off_argv);
+        format_duration(duration, sizeof(duration), status_next_decision_at - monotonic_ms());
+        snprintf(text, sizeof(text), "next check in %s", duration);
     }
+    gtk_label_set_text(GTK_LABEL(status_action_label), text);
+    return TRUE;
+}
 
-    g_idle_add(restart_daemon_async, NULL);
+static void show_daemon_not_running(void) {
+    gtk_label_set_text(GTK_LABEL(status_daemon_label), "Not running");
+    gtk_label_set_text(GTK_LABEL(status_idle_label), "-");
+    gtk_label_set_text(GTK_LABEL(status_timeout_label), "-");
+    gtk_label_set_text(GTK_LABEL(status_app_label), "-");
+    gtk_label_set_text(GTK_LABEL(status_rates_label), "-");
+    gtk_label_set_text(GTK_LABEL(status_action_label), "-");
 }
 
-gboolean restart_daemon_async(gpointer user_data) {
-    system("kill -9 $(cat ~/.XorgIdleManager/xorg_idle_manager_pids 2>/dev/null) 2>/dev/null");
-    system("rm -f ~/.XorgIdleManager/xorg_idle_manager_pids");
-    int stop_result = system("pkill -f XorgIdleManager_daemon.sh");
+static void apply_status_block(char *block) {
+    char pid[16] = "", matched_app[32] = "", top_process[32] = "", top_process_pid[16] = "";
+    time_t started = 0;
+    long idle = -1, timeout = 0;
+    long long next_decision = 0;
+    int long_running_timeout = 0, long_running_apps = 0, x_server = 0, cgroups = 0, pressure = 0;
+    double pressures[3] = {0};
+    double rates[ACTIVITY_SIGNALS] = {0};
+    int active[ACTIVITY_SIGNALS] = {0};
+
+    char *saveptr = NULL;
+    for (char *line = strtok_r(block, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr)) {
+        char *value = strchr(line, '=');
+        if (value == NULL) {
+            continue;
+        }
+        *value++ = '\0';
+        if (strcmp(line, "pid") == 0) snprintf(pid, sizeof(pid), "%s", value);
+        else if (strcmp(line, "started") == 0) started = (time_t)atoll(value);
+        else if (strcmp(line, "x_server") == 0) x_server = atoi(value);
+        else if (strcmp(line, "idle_ms") == 0) idle = atol(value);
+        else if (strcmp(line, "timeout_ms") == 0) timeout = atol(value);
+        else if (strcmp(line, "long_running_timeout") == 0) long_running_timeout = atoi(value);
+        else if (strcmp(line, "next_decision_ms") == 0) next_decision = atoll(value);
+        else if (strcmp(line, "long_running_apps") == 0) long_running_apps = atoi(value);
+        else if (strcmp(line, "matched_app") == 0) snprintf(matched_app, sizeof(matched_app), "%s", value);
+        else if (strcmp(line, "top_process") == 0) snprintf(top_process, sizeof(top_process), "%s", value);
+        else if (strcmp(line, "top_process_pid") == 0) snprintf(top_process_pid, sizeof(top_process_pid), "%s", value);
+        else if (strcmp(line, "cpu_usage") == 0) rates[ACTIVITY_CPU] = atof(value);
+        else if (strcmp(line, "io_kbps") == 0) rates[ACTIVITY_IO] = atof(value);
+        else if (strcmp(line, "net_kbps") == 0) rates[ACTIVITY_NET] = atof(value);
+        else if (strcmp(line, "cgroup_cpu_usage") == 0) { rates[ACTIVITY_CGROUP_CPU] = atof(value); cgroups = 1; }
+        else if (strcmp(line, "cpu_pressure") == 0) { pressures[0] = atof(value); pressure = 1; }
+        else if (strcmp(line, "io_pressure") == 0) pressures[1] = atof(value);
+        else if (strcmp(line, "memory_pressure") == 0) pressures[2] = atof(value);
+        else if (strcmp(line, "cgroup_io_kbps") == 0) rates[ACTIVITY_CGROUP_IO] = atof(value);
+        else if (strcmp(line, "cgroup_cpu_active") == 0) active[ACTIVITY_CGROUP_CPU] = atoi(value);
+        else if (strcmp(line, "cgroup_io_active") == 0) active[ACTIVITY_CGROUP_IO] = atoi(value);
+        else if (strcmp(line, "cpu_active") == 0) active[ACTIVITY_CPU] = atoi(value);
+        else if (strcmp(line, "io_active") == 0) active[ACTIVITY_IO] = atoi(value);
+        else if (strcmp(line, "net_active") == 0) active[ACTIVITY_NET] = atoi(value);
+    }
 
-    char exe_path[PATH_MAX];
-    ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
-    if (len == -1) {
-        show_error("Failed to determine executable path.");
-        return FALSE;
+    char text[384];
+    char duration[64];
+    char started_text[32] = "";
+    struct tm started_tm;
+    if (started > 0 && localtime_r(&started, &started_tm) != NULL) {
+        strftime(started_text, sizeof(started_text), ", since %Y-%m-%d %H:%M", &started_tm);
     }
-    exe_path[len] = '\0';
+    snprintf(text, sizeof(text), "Running (PID %s%s)", pid, started_text);
+    gtk_label_set_text(GTK_LABEL(status_daemon_label), text);
+
+    if (idle >= 0) {
+        format_duration(duration, sizeof(duration), idle);
+        gtk_label_set_text(GTK_LABEL(status_idle_label), duration);
+    } else {
+        gtk_label_set_text(GTK_LABEL(status_idle_label), x_server ? "-" : "no X server");
+    }
+
+    format_duration(duration, sizeof(duration), timeout);
+    snprintf(text, sizeof(text), "%s (%s)", duration, long_running_timeout ? "Long-Running Apps Timeout" : "Inactivity Timeout");
+    gtk_label_set_text(GTK_LABEL(status_timeout_label), text);
+
+    if (long_running_apps > 0) {
+        snprintf(text, sizeof(text), "%s (%d process%s)", matched_app[0] ? matched_app : "?", long_running_apps, long_running_apps == 1 ? "" : "es");
+    } else {
+        snprintf(text, sizeof(text), "None");
+    }
+    gtk_label_set_text(GTK_LABEL(status_app_label), text);
+
+    int length = snprintf(text, sizeof(text), "CPU %.1f %%%s, I/O %.1f KB/s%s, Network %.1f KB/s%s",
+                          rates[ACTIVITY_CPU], active[ACTIVITY_CPU] ? " (active)" : "",
+                          rates[ACTIVITY_IO], active[ACTIVITY_IO] ? " (active)" : "",
+                          rates[ACTIVITY_NET], active[ACTIVITY_NET] ? " (active)" : "");
+    if (pressure && length > 0 && (size_t)length < sizeof(text)) {
+        length += snprintf(text + length, sizeof(text) - length, "; pressure: CPU %.1f %%, I/O %.1f %%, memory %.1f %%",
+                           pressures[0], pressures[1], pressures[2]);
+    }
+    if (cgroups && length > 0 && (size_t)length < sizeof(text)) {
+        length += snprintf(text + length, sizeof(text) - length, "; cgroups: CPU %.1f %%%s, I/O %.1f KB/s%s",
+                           rates[ACTIVITY_CGROUP_CPU], active[ACTIVITY_CGROUP_CPU] ? " (active)" : "",
+                           rates[ACTIVITY_CGROUP_IO], active[ACTIVITY_CGROUP_IO] ? " (active)" : "");
+    }
+    if (top_process[0] && length > 0 && (size_t)length < sizeof(text)) {
+        snprintf(text + length, sizeof(text) - length, " - mostly %s (PID %s)", top_process, top_process_pid);
+    }
+    gtk_label_set_text(GTK_LABEL(status_rates_label), text);
+
+    status_x_server = x_server;
+    status_shown_timeout_ms = timeout;
+    status_next_decision_at = monotonic_ms() + next_decision;
+    refresh_status_countdown(NULL);
+}
 
-    char *working_dir = g_path_get_dirname(exe_path);
-    char *script_path = g_build_filename(working_dir, "XorgIdleManager_daemon.sh", NULL);
+static void close_status_subscription(void) {
+    if (status_countdown_source != 0) {
+        g_source_remove(status_countdown_source);
+        status_countdown_source = 0;
+    }
+    if (status_channel != NULL) {
+        close(g_io_channel_unix_get_fd(status_channel));
+        g_io_channel_unref(status_channel);
+        status_channel = NULL;
+    }
+    status_pending_length = 0;
+    show_daemon_not_running();
+}
 
-    FILE *script = fopen(script_path, "w");
-    if (script == NULL) {
-        show_error("Failed to create daemon script.");
-        g_free(working_dir);
-        g_free(script_path);
+/* Reads whatever arrived; of several complete blocks only the newest is shown. */
+static gboolean on_status_readable(GIOChannel *channel, GIOCondition condition, gpointer user_data) {
+    int fd = g_io_channel_unix_get_fd(channel);
+    for (;;) {
+        if (status_pending_length == sizeof(status_pending) - 1) {
+            status_pending_length = 0;
+        }
+        ssize_t len = read(fd, status_pending + status_pending_length, sizeof(status_pending) - 1 - status_pending_length);
+        if (len > 0) {
+            status_pending_length += len;
+            continue;
+        }
+        if (len == -1 && errno == EINTR) {
+            continue;
+        }
+        if (len == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        close_status_subscription();
         return FALSE;
     }
+    status_pending[status_pending_length] = '\0';
 
-    fprintf(script,
-    "#!/bin/bash\n"
-    "set -uo pipefail\n\n"
-    "HOME=%s\n"
-    "INACTIVITY_TIMEOUT=%d\n"
-    "LONG_RUNNING_APPS_TIMEOUT=%d\n"
-    "CUSTOM_LONG_RUNNING_APPS=\"%s\"\n"
-    "CHECK_INTERVAL=%d\n"
-    "CPU_THRESHOLD=%d\n"
-    "IO_THRESHOLD=%d\n"
-    "NET_THRESHOLD=%d\n"
-    "CPU_NET_CHECK_INTERVAL=%d\n"
-    "IO_CHECK_INTERVAL=%d\n"
-    "BOOT_GRACE_PERIOD=%d\n"
-    "ACTION_TYPE=%d\n"
-    "SLEEP_COMMAND=\"set +e; %s\"\n"
-    "SHUTDOWN_COMMAND=\"set +e; %s\"\n"
-    "CUSTOM_NO_GUI_COMMAND=\"set +e; %s\"\n\n"
-
-    "LOG_FILE=\"$HOME/.XorgIdleManager/xorg-idle-manager.log\"\n"
-    "MAX_LOG_SIZE=$((300 * 1024))  # 300 KB\n\n"
-    
-    "PIDS_FILE=\"$HOME/.XorgIdleManager/xorg_idle_manager_pids\"\n\n"
-
-    "if [ ! -d \"$HOME/.XorgIdleManager\" ]; then\n"
-    "    mkdir -p \"$HOME/.XorgIdleManager\"\n"
-    "    echo \"Directory $HOME/.XorgIdleManager created successfully\"\n"
-    "fi\n\n"
-
-    "truncate_log() {\n"
-    "    if [ -f \"$LOG_FILE\" ] && [ $(LC_ALL=C stat -c%%s \"$LOG_FILE\") -gt $MAX_LOG_SIZE ]; then\n"
-    "        LC_ALL=C tail -c $((MAX_LOG_SIZE / 2)) \"$LOG_FILE\" > \"$LOG_FILE.tmp\" && LC_ALL=C mv \"$LOG_FILE.tmp\" \"$LOG_FILE\"\n"
-    "        echo \"$(LC_ALL=C date '+%%Y-%%m-%%d %%H:%%M:%%S') - Log file truncated to half size\" >> \"$LOG_FILE\"\n"
-    "    fi\n"
-    "}\n\n"
-
-    "log() {\n"
-    "    truncate_log\n"
-    "    echo \"$(LC_ALL=C date '+%%Y-%%m-%%d %%H:%%M:%%S') - $1\" >> \"$LOG_FILE\"\n"
-    "}\n\n"
-
-    "truncate_log\n"
-    "log \"=== Script started at $(LC_ALL=C date) ===\"\n\n"
-
-    "check_command() {\n"
-    "    LC_ALL=C command -v \"$1\" &> /dev/null\n"
-    "}\n\n"
-
-    "required_commands=(\"awk\" \"bc\" \"history\" \"grep\" \"iostat\" \"sleep\" \"xprintidle\")\n"
-    "missing_commands=()\n"
-    "for cmd in \"${required_commands[@]}\"; do\n"
-    "    if ! check_command \"$cmd\"; then\n"
-    "        missing_commands+=(\"$cmd\")\n"
-    "    fi\n"
-    "done\n\n"
-
-    "if [ ${#missing_commands[@]} -ne 0 ]; then\n"
-    "    log \"Error: The following required utilities are missing:\"\n"
-    "    for cmd in \"${missing_commands[@]}\"; do\n"
-    "        log \"  - $cmd\"\n"
-    "    done\n"
-    "    log \"Please install the missing utilities and try again.\"\n"
-    "    exit 1\n"
-    "fi\n\n"
-
-    "log \"All required utilities are present. Starting the script...\"\n\n"
-
-    "while [[ $# -gt 0 ]]; do\n"
-    "    case $1 in\n"
-    "        --home)\n"
-    "            HOME=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --inactivity-timeout)\n"
-    "            INACTIVITY_TIMEOUT=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --long-running-apps-timeout)\n"
-    "            LONG_RUNNING_APPS_TIMEOUT=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --custom-long-running-apps)\n"
-    "            CUSTOM_LONG_RUNNING_APPS=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --check-interval)\n"
-    "            CHECK_INTERVAL=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --cpu-threshold)\n"
-    "            CPU_THRESHOLD=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --io-threshold)\n"
-    "            IO_THRESHOLD=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --net-threshold)\n"
-    "            NET_THRESHOLD=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --cpu-net-check-interval)\n"
-    "            CPU_NET_CHECK_INTERVAL=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --io-check-interval)\n"
-    "            IO_CHECK_INTERVAL=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --boot_grace_period)\n"
-    "            BOOT_GRACE_PERIOD=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --action-type)\n"
-    "            ACTION_TYPE=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --sleep-command)\n"
-    "            SLEEP_COMMAND=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --shutdown-command)\n"
-    "            SHUTDOWN_COMMAND=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        --custom-no-gui-command)\n"
-    "            CUSTOM_NO_GUI_COMMAND=\"$2\"\n"
-    "            shift 2 ;;\n"
-    "        *)\n"
-    "            echo \"Unknown parameter: $1\"\n"
-    "            exit 1 ;;\n"
-    "    esac\n"
-    "done\n\n"
-
-    "is_system_booting() {\n"
-    "    local uptime_seconds\n"
-    "    uptime_seconds=$(awk '{print int($1)}' /proc/uptime)\n"
-    "    local minutes=$((uptime_seconds / 60))\n"
-    "\n"
-    "    if [[ $minutes -lt $BOOT_GRACE_PERIOD ]]; then\n"
-    "        log \"System is in boot grace period (${minutes} minutes < boot grace period of ${BOOT_GRACE_PERIOD} minutes)\"\n"
-    "        return 0\n"
-    "    else\n"
-    "        log \"System boot grace period has passed (boot grace period: ${BOOT_GRACE_PERIOD} minutes)\"\n"
-    "        return 1\n"
-    "    fi\n"
-    "}\n\n"
-
-    "check_gui() {\n"
-    "    log \"Checking for GUI with X server\"\n"
-    "    \n"
-    "    if [ \"${XDG_SESSION_TYPE:-}\" = \"x11\" ]; then\n"
-    "        log \"GUI detected via XDG_SESSION_TYPE=x11\"\n"
-    "        return 0\n"
-    "    fi\n"
-    "    \n"
-    "    if [ -n \"${DISPLAY:-}\" ] && command -v xset >/dev/null; then\n"
-    "        if timeout 5 xset q >/dev/null 2>&1; then\n"
-    "            log \"X server is active (DISPLAY=$DISPLAY)\"\n"
-    "            return 0\n"
-    "        else\n"
-    "            log \"X server DISPLAY exists but unresponsive\"\n"
-    "            return 1\n"
-    "        fi\n"
-    "    fi\n"
-    "    \n"
-    "    if timeout 5 pgrep -x \"Xorg\" >/dev/null; then\n"
-    "        log \"Xorg process detected\"\n"
-    "        return 0\n"
-    "    else\n"
-    "        log \"No Xorg process found\"\n"
-    "    fi\n"
-    "    \n"
-    "    if timeout 5 pgrep -f \"xfce|mate-session|lxsession|cinnamon|openbox|fluxbox|i3|awesome|bspwm|dwm|xmonad|qtile|herbstluftwm|jwm|icewm|blackbox|fvwm|twm|gnome-shell|kwin_wayland|sway\" >/dev/null; then\n"
-    "        log \"GUI environment detected, but not X server\"\n"
-    "    fi\n"
-    "    \n"
-    "    log \"No active X server found\"\n"
-    "    return 1\n"
-    "}\n\n"
-
-    "check_no_gui_user_activity() {\n"
-    "    local tty=\"/dev/pts/$(tty | awk -F'/' '{print $NF}')\"\n"
-    "    local last_update=$(stat -c %Y \"$tty\" 2>/dev/null || echo 0)\n"
-    "    local current_time=$(cat /proc/uptime | awk '{print int($1)}')\n\n"
-    "    local inactivity_timeout_seconds=$((INACTIVITY_TIMEOUT / 1000))\n\n"
-    "    if [ $((current_time - last_update)) -lt $inactivity_timeout_seconds ]; then\n"
-    "        log \"User activity detected based on TTY interaction.\"\n"
-    "        return 0\n"
-    "    else\n"
-    "        log \"No user activity detected.\"\n"
-    "        return 1\n"
-    "    fi\n"
-    "}\n\n"
-
-    "check_cpu_activity() {\n"
-    "    log \"Checking CPU activity\"\n"
-    "    read total1 idle1 < <(LC_ALL=C awk '/cpu / {print $2+$3+$4+$5+$6+$7+$8, $5}' /proc/stat)\n"
-    "    LC_ALL=C sleep $CPU_NET_CHECK_INTERVAL\n"
-    "    read total2 idle2 < <(LC_ALL=C awk '/cpu / {print $2+$3+$4+$5+$6+$7+$8, $5}' /proc/stat)\n\n"
-    "    local total_diff=$((total2 - total1))\n"
-    "    [ $total_diff -eq 0 ] && total_diff=1\n"
-    "    local idle_diff=$((idle2 - idle1))\n"
-    "    local cpu_usage=$(echo \"scale=2; 100 * ($total_diff - $idle_diff) / $total_diff\" | bc)\n"
-    "    cpu_usage=$(echo \"if ($cpu_usage < 0) 0 else $cpu_usage\" | bc)\n"
-    "    cpu_usage=${cpu_usage/#./0.}\n"
-    "    log \"CPU usage: ${cpu_usage}%\"\n"
-    "    if (( $(echo \"${cpu_usage} > $CPU_THRESHOLD\" | bc -l) )); then\n"
-    "        log \"High CPU activity detected: ${cpu_usage}% (threshold: $CPU_THRESHOLD%)\"\n"
-    "        return 0\n"
-    "    else\n"
-    "        log \"CPU activity below threshold: ${cpu_usage}% (threshold: $CPU_THRESHOLD%)\"\n"
-    "        return 1\n"
-    "    fi\n"
-    "}\n\n"
-
-    "check_io_activity() {\n"
-    "    log \"Checking I/O activity\"\n"
-    "    log \"Running iostat command with interval: $IO_CHECK_INTERVAL\"\n"
-    "    local iostat_output\n"
-    "    iostat_output=$(LC_ALL=C timeout $((IO_CHECK_INTERVAL * 2 + 1)) iostat -d -k -y $IO_CHECK_INTERVAL 1 2>&1)\n"
-    "    local exit_status=$?\n"
-    "    if [ $exit_status -eq 124 ]; then\n"
-    "        log \"iostat command timed out\"\n"
-    "        return 1\n"
-    "    elif [ $exit_status -ne 0 ]; then\n"
-    "        log \"iostat command failed with exit status $exit_status\"\n"
-    "        return 1\n"
-    "    fi\n"
-    "    log \"iostat command completed. Output: $iostat_output\"\n"
-    "    \n"
-    "    local read_activity=$(echo \"$iostat_output\" | awk '/^[a-z]/ && $3 ~ /^[0-9.]+$/ {sum_read += $3} END {print sum_read+0}')\n"
-    "    local write_activity=$(echo \"$iostat_output\" | awk '/^[a-z]/ && $4 ~ /^[0-9.]+$/ {sum_write += $4} END {print sum_write+0}')\n"
-    "    local io_activity=$(echo \"$read_activity + $write_activity\" | bc)\n"
-    "    log \"Read activity: $read_activity KB/s, Write activity: $write_activity KB/s\"\n"
-    "    log \"Total I/O activity: $io_activity KB/s\"\n"
-    "    \n"
-    "    if (( $(echo \"$io_activity > $IO_THRESHOLD\" | bc -l) )); then\n"
-    "        log \"High I/O activity detected: $io_activity KB/s (threshold: $IO_THRESHOLD KB/s)\"\n"
-    "        return 0\n"
-    "    else\n"
-    "        log \"I/O activity below threshold: $io_activity KB/s (threshold: $IO_THRESHOLD KB/s)\"\n"
-    "        return 1\n"
-    "    fi\n"
-    "}\n\n"
-
-    "check_network_activity() {\n"
-    "    log \"Checking network activity\"\n"
-    "    local start_values end_values net_activity\n"
-    "    read -r start_values < <(LC_ALL=C awk '$1 ~ /^[[:alnum:]]+:$/ && $1 !~ /^lo:/ {sum += $2 + $10} END {print sum+0}' /proc/net/dev)\n"
-    "    LC_ALL=C sleep $CPU_NET_CHECK_INTERVAL\n"
-    "    read -r end_values < <(LC_ALL=C awk '$1 ~ /^[[:alnum:]]+:$/ && $1 !~ /^lo:/ {sum += $2 + $10} END {print sum+0}' /proc/net/dev)\n"
-    "    net_activity=$(echo \"scale=1; ($end_values - $start_values) / ($CPU_NET_CHECK_INTERVAL * 1024)\" | bc)\n"
-    "    net_activity=$(echo \"if ($net_activity < 0) 0 else $net_activity\" | bc)\n"
-    "    net_activity=${net_activity/#./0.}\n"
-    "    log \"Network activity: ${net_activity} KB/s\"\n"
-    "    if (( $(echo \"$net_activity > $NET_THRESHOLD\" | bc -l) )); then\n"
-    "        log \"High network activity detected: ${net_activity} KB/s (threshold: $NET_THRESHOLD KB/s)\"\n"
-    "        return 0\n"
-    "    else\n"
-    "        log \"Network activity below threshold: ${net_activity} KB/s (threshold: $NET_THRESHOLD KB/s)\"\n"
-    "        return 1\n"
-    "    fi\n"
-    "}\n\n"
-
-    "check_system_activity() {\n"
-    "    log \"Checking system activity\"\n"
-    "    if check_cpu_activity || check_io_activity || check_network_activity; then\n"
-    "        log \"System activity detected\"\n"
-    "        return 0\n"
-    "    else\n"
-    "        log \"No significant system activity detected\"\n"
-    "        return 1\n"
-    "    fi\n"
-    "}\n\n"
-    
-    "check_long_running_apps_active() {\n"
-    "    local current_pid=$$\n"
-    "    LC_ALL=C ps -eo pid,comm= | grep -E \"($CUSTOM_LONG_RUNNING_APPS)\" | grep -v \"^$current_pid \" > /dev/null\n"
-    "}\n"
-
-    "perform_action() {\n"
-    "    local environment=\"$1\"\n"
-    "    \n"
-    "    if [ \"$environment\" = \"no-gui\" ]; then\n"
-    "        if [ -n \"$CUSTOM_NO_GUI_COMMAND\" ]; then\n"
-    "            log \"Executing Custom No X Server Command: $CUSTOM_NO_GUI_COMMAND\"\n"
-    "            eval \"$CUSTOM_NO_GUI_COMMAND\"\n"
-    "        else\n"
-    "            log \"Warning: No custom command defined for no-X-server environment. No action taken.\"\n"
-    "        fi\n"
-    "    else\n"
-    "        if [ \"$ACTION_TYPE\" -eq 0 ]; then\n"
-    "            if [ -n \"$SLEEP_COMMAND\" ]; then\n"
-    "                log \"Executing GUI Sleep Command: $SLEEP_COMMAND\"\n"
-    "                eval \"$SLEEP_COMMAND\"\n"
-    "            else\n"
-    "                log \"Warning: No sleep command defined for X-server environment. No action taken.\"\n"
-    "            fi\n"
-    "        else\n"
-    "            if [ -n \"$SHUTDOWN_COMMAND\" ]; then\n"
-    "                log \"Executing GUI Shutdown Command: $SHUTDOWN_COMMAND\"\n"
-    "                eval \"$SHUTDOWN_COMMAND\"\n"
-    "            else\n"
-    "                log \"Warning: No shutdown command defined for X-server environment. No action taken.\"\n"
-    "            fi\n"
-    "        fi\n"
-    "    fi\n"
-    "}\n\n"
-
-    "cleanup_pids() {\n"
-    "    [ -f \"$PIDS_FILE\" ] && \n"
-    "    awk '{ if (system(\"ps -p \" $1 \" >/dev/null 2>&1\") == 0) print $1 }' \"$PIDS_FILE\" > \"$PIDS_FILE.tmp\" && \n"
-    "    mv \"$PIDS_FILE.tmp\" \"$PIDS_FILE\"\n"
-    "}\n"
-
-    "limit_pids() {\n"
-    "    [ -f \"$PIDS_FILE\" ] && tail -n 50 \"$PIDS_FILE\" > \"$PIDS_FILE.tmp\" && mv \"$PIDS_FILE.tmp\" \"$PIDS_FILE\"\n"
-    "}\n"
-
-    "echo $$ > \"$PIDS_FILE\"\n"
-    "log \"Main script PID saved to $PIDS_FILE\"\n"
-
-    "    log \"Entering main loop\"\n"
-    "    \n"
-    "    while true; do\n"
-    "        for cmd in awk bc grep iostat; do\n"
-    "            pgrep -P $$ -f \"$cmd\" >> \"$PIDS_FILE\"\n"
-    "            log \"Checked for $cmd processes.\"\n"
-    "        done\n"
-    "\n"
-    "        cleanup_pids\n"
-    "\n"
-    "        log \"Starting main loop iteration.\"\n"
-    "        if is_system_booting; then\n"
-    "            log \"System is booting, skipping activity check this iteration\"\n"
-    "            log \"Sleeping for ${CHECK_INTERVAL} seconds.\"\n"
-    "            LC_ALL=C sleep $CHECK_INTERVAL & echo $! >> \"$PIDS_FILE\"\n"
-    "            wait $!\n"
-    "            cleanup_pids\n"
-    "            limit_pids\n"
-    "            log \"Boot grace iteration complete, continuing.\"\n"
-    "            continue\n"
-    "        fi\n"
-    "\n"
-    "        # Перевіряємо, чи запущений Xorg або X\n"
-    "        if ! pgrep Xorg >/dev/null 2>&1 && ! pgrep X >/dev/null 2>&1; then\n"
-    "            log \"X server not active yet, skipping xprintidle check.\"\n"
-    "            LC_ALL=C sleep $CHECK_INTERVAL & echo $! >> \"$PIDS_FILE\"\n"
-    "            wait $!\n"
-    "            continue\n"
-    "        fi\n"
-    "\n"
-    "        # Динамічне визначення користувача та змінних оточення\n"
-    "        CURRENT_USER=$(who | awk '/(:0)/ {print $1; exit}')\n"
-    "        if [ -n \"$CURRENT_USER\" ]; then\n"
-    "            export DISPLAY=:0\n"
-    "            XAUTH_PATH=\"/home/$CURRENT_USER/.Xauthority\"\n"
-    "            if [ -f \"$XAUTH_PATH\" ]; then\n"
-    "                export XAUTHORITY=\"$XAUTH_PATH\"\n"
-    "                log \"Set XAUTHORITY to $XAUTH_PATH for user $CURRENT_USER\"\n"
-    "            else\n"
-    "                log \"Xauthority file not found for user $CURRENT_USER, unsetting XAUTHORITY\"\n"
-    "                unset XAUTHORITY\n"
-    "            fi\n"
-    "        else\n"
-    "            log \"No active user for DISPLAY=:0 session found, unsetting XAUTHORITY\"\n"
-    "            unset XAUTHORITY\n"
-    "            export DISPLAY=:0\n"
-    "        fi\n"
-    "\n"
-    "        if check_gui; then\n"
-    "            log \"X server detected. Using standard logic.\"\n"
-    "            user_inactive_time=$(LC_ALL=C xprintidle 2>/dev/null)\n"
-    "            if [ -z \"$user_inactive_time\" ]; then\n"
-    "                log \"xprintidle returned no data, skipping iteration\"\n"
-    "                LC_ALL=C sleep $CHECK_INTERVAL & echo $! >> \"$PIDS_FILE\"\n"
-    "                wait $!\n"
-    "                continue\n"
-    "            fi\n"
-    "            log \"xprintidle returned: $user_inactive_time\"\n"
-    "            if check_long_running_apps_active; then\n"
-    "                timeout=$LONG_RUNNING_APPS_TIMEOUT\n"
-    "                extended_timeout_seconds=$(echo \"scale=2; $LONG_RUNNING_APPS_TIMEOUT / 1000\" | bc)\n"
-    "                log \"Long-running apps active. Using extended timeout: ${extended_timeout_seconds} seconds\"\n"
-    "            else\n"
-    "                timeout=$INACTIVITY_TIMEOUT\n"
-    "                standard_timeout_seconds=$(echo \"scale=2; $INACTIVITY_TIMEOUT / 1000\" | bc)\n"
-    "                log \"No long-running apps active. Using standard timeout: ${standard_timeout_seconds} seconds\"\n"
-    "            fi\n"
-    "\n"
-    "            inactive_time_seconds=$(echo \"scale=2; $user_inactive_time / 1000\" | bc)\n"
-    "            current_timeout_seconds=$(echo \"scale=2; $timeout / 1000\" | bc)\n"
-    "            inactive_time_seconds=$(sed 's/^\\./0./' <<< \"$inactive_time_seconds\")\n"
-    "            log \"User inactive time: ${inactive_time_seconds} seconds (current timeout: ${current_timeout_seconds} seconds).\"\n"
-    "\n"
-    "            if (( user_inactive_time < timeout )); then\n"
-    "                log \"User activity detected (screen active). Skipping system activity check.\"\n"
-    "            elif ! check_system_activity; then\n"
-    "                log \"Inactivity timeout reached and no system activity detected. Initiating X-server action.\"\n"
-    "                perform_action \"gui\"\n"
-    "            else\n"
-    "                log \"System activity detected despite user inactivity. Continuing to monitor.\"\n"
-    "            fi\n"
-    "        else\n"
-    "            log \"No X server detected. Using no-X-server user activity check.\"\n"
-    "            if check_no_gui_user_activity; then\n"
-    "                log \"User activity detected in no-X-server environment. Resetting timer.\"\n"
-    "            elif ! check_system_activity; then\n"
-    "                log \"No user activity and no system activity detected in no-X-server environment. Initiating no-X-server action.\"\n"
-    "                perform_action \"no-gui\"\n"
-    "            else\n"
-    "                log \"System activity detected in no-X-server environment. Continuing to monitor.\"\n"
-    "            fi\n"
-    "        fi\n"
-    "\n"
-    "        log \"Sleeping for ${CHECK_INTERVAL} seconds.\"\n"
-    "        LC_ALL=C sleep $CHECK_INTERVAL & echo $! >> \"$PIDS_FILE\"\n"
-    "        wait $!\n"
-    "        cleanup_pids\n"
-    "        limit_pids\n"
-    "        log \"End of loop iteration.\"\n"
-    "    done\n",
-
-    getenv("HOME"),
-    inactivity_timeout,
-    long_running_apps_timeout,
-    custom_long_running_apps,
-    check_interval,
-    cpu_threshold,
-    io_threshold,
-    net_threshold,
-    cpu_net_check_interval,
-    io_check_interval,
-    boot_grace_period,
-    action_type,
-    sleep_command,
-    shutdown_command,
-    custom_no_gui_command);
-
-    fclose(script);
-    chmod(script_path, 0755);
+    char *end = NULL;
+    for (char *p = strstr(status_pending, "\n\n"); p != NULL; p = strstr(p + 2, "\n\n")) {
+        end = p;
+    }
+    if (end == NULL) {
+        return TRUE;
+    }
+    *end = '\0';
+    char *start = status_pending;
+    for (char *p = strstr(status_pending, "\n\n"); p != NULL && p < end; p = strstr(p + 2, "\n\n")) {
+        start = p + 2;
+    }
+    apply_status_block(start);
+
+    size_t rest = status_pending_length - (end + 2 - status_pending);
+    memmove(status_pending, end + 2, rest);
+    status_pending_length = rest;
+    return TRUE;
+}
+
+static int subscribe_daemon_status(void) {
+    if (status_channel != NULL) {
+        return 1;
+    }
+    int fd = connect_control_socket("subscribe", 0);
+    if (fd == -1) {
+        show_daemon_not_running();
+        return 0;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    status_channel = g_io_channel_unix_new(fd);
+    g_io_add_watch(status_channel, G_IO_IN | G_IO_HUP | G_IO_ERR, on_status_readable, NULL);
+    status_countdown_source = g_timeout_add_seconds(1, refresh_status_countdown, NULL);
+    return 1;
+}
+
+/* A freshly started daemon needs a moment before its control socket exists. */
+static gboolean retry_status_subscription(gpointer user_data) {
+    return !subscribe_daemon_status() && ++status_subscribe_attempts < 10;
+}
+
+/*
+ * Asks the daemon to stop over its control socket and waits up to five seconds for it to exit.
+ * The daemon's PID comes from the socket's peer credentials, and its exit is awaited on a pidfd.
+ */
+int stop_running_daemon(void) {
+    int fd = connect_control_socket("stop", 5);
+    if (fd == -1) {
+        return 0;
+    }
+
+    struct ucred credentials;
+    socklen_t credentials_length = sizeof(credentials);
+    int pidfd = -1;
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_length) == 0) {
+        pidfd = (int)syscall(SYS_pidfd_open, credentials.pid, 0);
+    }
+
+    char reply[MAX_ERROR_LENGTH];
+    while (recv(fd, reply, sizeof(reply), 0) > 0) {
+    }
+    close(fd);
+
+    if (pidfd != -1) {
+        struct pollfd exited = {pidfd, POLLIN, 0};
+        poll(&exited, 1, 5000);
+        close(pidfd);
+    }
+    return 1;
+}
+
+/*
+ * A running daemon applies the saved config.ini in place and says whether it accepted it;
+ * otherwise a new daemon is started. Returns 0 with the reason when the settings did not take.
+ */
+static int apply_config_to_daemon(char *message, size_t size, int *started) {
+    char reply[MAX_ERROR_LENGTH];
+    *started = 0;
+    int result = send_control_command("reload", reply, sizeof(reply));
+    if (result == 1) {
+        snprintf(message, size, "Applied by the running daemon.");
+        return 1;
+    }
+    if (result == 0) {
+        if (reply[0] == '\0') {
+            snprintf(message, size, "The daemon has not confirmed it yet and will apply it after its current check.");
+            return 1;
+        }
+        snprintf(message, size, "The daemon rejected the configuration and kept its previous settings: %s", reply);
+        return 0;
+    }
+
+    char exe_path[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+    if (len == -1) {
+        snprintf(message, size, "Failed to determine executable path.");
+        return 0;
+    }
+    exe_path[len] = '\0';
 
     pid_t pid = fork();
     if (pid == -1) {
-        show_error("Failed to fork process for starting daemon.");
-        g_free(working_dir);
-        g_free(script_path);
-        return FALSE;
+        snprintf(message, size, "Failed to fork process for starting daemon.");
+        return 0;
     }
 
     if (pid == 0) {
         setsid();
-        execl("/bin/bash", "/bin/bash", script_path, NULL);
+        execl(exe_path, exe_path, "--daemon", NULL);
         _exit(EXIT_FAILURE);
     }
 
-    g_free(working_dir);
-    g_free(script_path);
+    *started = 1;
+    snprintf(message, size, "Daemon started.");
+    return 1;
+}
 
-    if (stop_result == 0) {
-        show_info("Configuration saved and daemon restarted successfully.");
-    } else {
-        show_info("Configuration saved and daemon started successfully.");
-    }
+/*
+ * Save & Apply validates on the GTK thread, then hands a snapshot of the settings to a GTask
+ * worker that writes config.ini, applies DPMS over its own X connection and reloads the daemon.
+ * Each stage reports to the label under the buttons; the window stays responsive throughout.
+ */
+enum apply_stage {
+    APPLY_STAGE_CONFIG,
+    APPLY_STAGE_DPMS,
+    APPLY_STAGE_DAEMON,
+    APPLY_STAGES
+};
+
+static const char *apply_stage_names[APPLY_STAGES] = {
+    "Saving config.ini",
+    "Applying DPMS settings",
+    "Applying the configuration to the daemon"
+};
+
+struct apply_job {
+    char *config_text;
+    size_t config_length;
+    char display_name[256];
+    int dpms_enabled;
+    int dpms_standby;
+    int dpms_suspend;
+    int dpms_off;
+    int failed;
+    int daemon_started;
+    char messages[APPLY_STAGES][MAX_ERROR_LENGTH + 128];
+};
+
+static void free_apply_job(gpointer data) {
+    struct apply_job *job = data;
+    free(job->config_text);
+    free(job);
+}
 
+static gboolean show_apply_stage(gpointer data) {
+    int stage = GPOINTER_TO_INT(data);
+    char text[128];
+    snprintf(text, sizeof(text), "%s... (%d/%d)", apply_stage_names[stage], stage + 1, APPLY_STAGES);
+    gtk_label_set_text(GTK_LABEL(apply_progress_label), text);
     return FALSE;
 }
 
-GtkWidget *create_button(const char *label, GCallback callback) {
-    GtkWidget *button = gtk_button_new_with_label(label);
-    g_signal_connect(button, "clicked", callback, NULL);
-    return button;
+static void report_apply_stage(int stage) {
+    g_main_context_invoke(NULL, show_apply_stage, GINT_TO_POINTER(stage));
 }
 
-void show_license_info(GtkWidget *widget, gpointer data) {
-    const char *license_text = "GNU GENERAL PUBLIC LICENSE\n\n"
-"Version 3, 29 June 2007\n\n"
-"Copyright © 2007 Free Software Foundation, Inc. <https://fsf.org/>\n\n"
-"Everyone is permitted to copy and distribute verbatim copies of this license document, but changing it is not allowed.\n\n"
-"Preamble\n\n"
-"The GNU General Public License is a free, copyleft license for software and other kinds of works.\n\n"
-"The licenses for most software and other practical works are designed to take away your freedom to share and change the works. By contrast, the GNU General Public License is intended to guarantee your freedom to share and change all versions of a program--to make sure it remains free software for all its users. We, the Free Software Foundation, use the GNU General Public License for most of our software; it applies also to any other work released this way by its authors. You can apply it to your programs, too.\n\n"
-"When we speak of free software, we are referring to freedom, not price. Our General Public Licenses are designed to make sure that you have the freedom to distribute copies of free software (and charge for them if you wish), that you receive source code or can get it if you want it, that you can change the software or use pieces of it in new free programs, and that you know you can do these things.\n\n"
-"To protect your rights, we need to prevent others from denying you these rights or asking you to surrender the rights. Therefore, you have certain responsibilities if you distribute copies of the software, or if you modify it: responsibilities to respect the freedom of others.\n\n"
-"For example, if you distribute copies of such a program, whether gratis or for a fee, you must pass on to the recipients the same freedoms that you received. You must make sure that they, too, receive or can get the source code. And you must show them these terms so they know their rights.\n\n"
-"Developers that use the GNU GPL protect your rights with two steps: (1) assert copyright on the software, and (2) offer you this License giving you legal permission to copy, distribute and/or modify it.\n\n"
-"For the developers' and authors' protection, the GPL clearly explains that there is no warranty for this free software. For both users' and authors' sake, the GPL requires that modified versions be marked as changed, so that their problems will not be attributed erroneously to authors of previous versions.\n\n"
-"Some devices are designed to deny users access to install or run modified versions of the software inside them, although the manufacturer can do so. This is fundamentally incompatible with the aim of protecting users' freedom to change the software. The systematic pattern of such abuse occurs in the area of products for individuals to use, which is precisely where it is most unacceptable. Therefore, we have designed this version of the GPL to prohibit the practice for those products. If such problems arise substantially in other domains, we stand ready to extend this provision to those domains in future versions of the GPL, as needed to protect the freedom of users.\n\n"
-"Finally, every program is threatened constantly by software patents. States should not allow patents to restrict development and use of software on general-purpose computers, but in those that do, we wish to avoid the special danger that patents applied to a free program could make it effectively proprietary. To prevent this, the GPL assures that patents cannot be used to render the program non-free.\n\n"
-"The precise terms and conditions for copying, distribution and modification follow.\n\n"
-"TERMS AND CONDITIONS\n\n"
-"0. Definitions.\n\n"
-"This License” refers to version 3 of the GNU General Public License.\n\n"
-"“Copyright” also means copyright-like laws that apply to other kinds of works, such as semiconductor masks.\n\n"
-"“The Program” refers to any copyrightable work licensed under this License. Each licensee is addressed as “you”. “Licensees” and “recipients” may be individuals or organizations.\n\n"
-"To “modify” a work means to copy from or adapt all or part of the work in a fashion requiring copyright permission, other than the making of an exact copy. The resulting work is called a “modified version” of the earlier work or a work “based on” the earlier work.\n\n"
-"A “covered work” means either the unmodified Program or a work based on the Program.\n\n"
-"To “propagate” a work means to do anything with it that, without permission, would make you directly or secondarily liable for infringement under applicable copyright law, except executing it on a computer or modifying a private copy. Propagation includes copying, distribution (with or without modification), making available to the public, and in some countries other activities as well.\n\n"
-"To “convey” a work means any kind of propagation that enables other parties to make or receive copies. Mere interaction with a user through a computer network, with no transfer of a copy, is not conveying.\n\n"
-"An interactive user interface displays “Appropriate Legal Notices” to the extent that it includes a convenient and prominently visible feature that (1) displays an appropriate copyright notice, and (2) tells the user that there is no warranty for the work (except to the extent that warranties are provided), that licensees may convey the work under this License, and how to view a copy of this License. If the interface presents a list of user commands or options, such as a menu, a prominent item in the list meets this criterion.\n\n"
-"1. Source Code.\n\n"
-"The “source code” for a work means the preferred form of the work for making modifications to it. “Object code” means any non-source form of a work.\n\n"
-"A “Standard Interface” means an interface that either is an official standard defined by a recognized standards body, or, in the case of interfaces specified for a particular programming language, one that is widely used among developers working in that language.\n\n"
-"The “System Libraries” of an executable work include anything, other than the work as a whole, that (a) is included in the normal form of packaging a Major Component, but which is not part of that Major Component, and (b) serves only to enable use of the work with that Major Component, or to implement a Standard Interface for which an implementation is available to the public in source code form. A “Major Component”, in this context, means a major essential component (kernel, window system, and so on) of the specific operating system (if any) on which the executable work runs, or a compiler used to produce the work, or an object code interpreter used to run it.\n\n"
-"The “Corresponding Source” for a work in object code form means all the source code needed to generate, install, and (for an executable work) run the object code and to modify the work, including scripts to control those activities. However, it does not include the work's System Libraries, or general-purpose tools or generally available free programs which are used unmodified in performing those activities but which are not part of the work. For example, Corresponding Source includes interface definition files associated with source files for the work, and the source code for shared libraries and dynamically linked subprograms that the work is specifically designed to require, such as by intimate data communication or control flow between those subprograms and other parts of the work.\n\n"
-"The Corresponding Source need not include anything that users can regenerate automatically from other parts of the Corresponding Source.\n\n"
-"The Corresponding Source for a work in source code form is that same work.\n\n"
-"2. Basic Permissions.\n\n"
-"All rights granted under this License are granted for the term of copyright on the Program, and are irrevocable provided the stated conditions are met. This License explicitly affirms your unlimited permission to run the unmodified Program. The output from running a covered work is covered by this License only if the output, given its content, constitutes a covered work. This License acknowledges your rights of fair use or other equivalent, as provided by copyright law.\n\n"
-"You may make, run and propagate covered works that you do not convey, without conditions so long as your license otherwise remains in force. You may convey covered works to others for the sole purpose of having them make modifications exclusively for you, or provide you with facilities for running those works, provided that you comply with the terms of this License in conveying all material for which you do not control copyright. Those thus making or running the covered works for you must do so exclusively on your behalf, under your direction and control, on terms that prohibit them from making any copies of your copyrighted material outside their relationship with you.\n\n"
-"Conveying under any other circumstances is permitted solely under the conditions stated below. Sublicensing is not allowed; section 10 makes it unnecessary.\n\n"
-"3. Protecting Users' Legal Rights From Anti-Circumvention Law.\n\n"
-"No covered work shall be deemed part of an effective technological measure under any applicable law fulfilling obligations under article 11 of the WIPO copyright treaty adopted on 20 December 1996, or similar laws prohibiting or restricting circumvention of such measures.\n\n"
-"When you convey a covered work, you waive any legal power to forbid circumvention of technological measures to the extent such circumvention is effected by exercising rights under this License with respect to the covered work, and you disclaim any intention to limit operation or modification of the work as a means of enforcing, against the work's users, your or third parties' legal rights to forbid circumvention of technological measures.\n\n"
-"4. Conveying Verbatim Copies.\n\n"
-"You may convey verbatim copies of the Program's source code as you receive it, in any medium, provided that you conspicuously and appropriately publish on each copy an appropriate copyright notice; keep intact all notices stating that this License and any non-permissive terms added in accord with section 7 apply to the code; keep intact all notices of the absence of any warranty; and give all recipients a copy of this License along with the Program.\n\n"
-"You may charge any price or no price for each copy that you convey, and you may offer support or warranty protection for a fee.\n\n"
-"5. Conveying Modified Source Versions.\n\n"
-"You may convey a work based on the Program, or the modifications to produce it from the Program, in the form of source code under the terms of section 4, provided that you also meet all of these conditions:\n\n"
-"    a) The work must carry prominent notices stating that you modified it, and giving a relevant date.\n\n"
-"    b) The work must carry prominent notices stating that it is released under this License and any conditions added under section 7. This requirement modifies the requirement in section 4 to “keep intact all notices”.\n\n"
-"    c) You must license the entire work, as a whole, under this License to anyone who comes into possession of a copy. This License will therefore apply, along with any applicable section 7 additional terms, to the whole of the work, and all its parts, regardless of how they are packaged. This License gives no permission to license the work in any other way, but it does not invalidate such permission if you have separately received it.\n\n"
-"    d) If the work has interactive user interfaces, each must display Appropriate Legal Notices; however, if the Program has interactive interfaces that do not display Appropriate Legal Notices, your work need not make them do so.\n\n"
-"A compilation of a covered work with other separate and independent works, which are not by their nature extensions of the covered work, and which are not combined with it such as to form a larger program, in or on a volume of a storage or distribution medium, is called an “aggregate” if the compilation and its resulting copyright are not used to limit the access or legal rights of the compilation's users beyond what the individual works permit. Inclusion of a covered work in an aggregate does not cause this License to apply to the other parts of the aggregate.\n\n"
-"6. Conveying Non-Source Forms.\n\n"
-"You may convey a covered work in object code form under the terms of sections 4 and 5, provided that you also convey the machine-readable Corresponding Source under the terms of this License, in one of these ways:\n\n"
-"    a) Convey the object code in, or embodied in, a physical product (including a physical distribution medium), accompanied by the Corresponding Source fixed on a durable physical medium customarily used for software interchange.\n\n"
-"    b) Convey the object code in, or embodied in, a physical product (including a physical distribution medium), accompanied by a written offer, valid for at least three years and valid for as long as you offer spare parts or customer support for that product model, to give anyone who possesses the object code either (1) a copy of the Corresponding Source for all the software in the product that is covered by this License, on a durable physical medium customarily used for software interchange, for a price no more than your reasonable cost of physically performing this conveying of source, or (2) access to copy the Corresponding Source from a network server at no charge.\n\n"
-"    c) Convey individual copies of the object code with a copy of the written offer to provide the Corresponding Source. This alternative is allowed only occasionally and noncommercially, and only if you received the object code with such an offer, in accord with subsection 6b.\n\n"
-"    d) Convey the object code by offering access from a designated place (gratis or for a charge), and offer equivalent access to the Corresponding Source in the same way through the same place at no further charge. You need not require recipients to copy the Corresponding Source along with the object code. If the place to copy the object code is a network server, the Corresponding Source may be on a different server (operated by you or a third party) that supports equivalent copying facilities, provided you maintain clear directions next to the object code saying where to find the Corresponding Source. Regardless of what server hosts the Corresponding Source, you remain obligated to ensure that it is available for as long as needed to satisfy these requirements.\n\n"
-"    e) Convey the object code using peer-to-peer transmission, provided you inform other peers where the object code and Corresponding Source of the work are being offered to the general public at no charge under subsection 6d.\n\n"
-"A separable portion of the object code, whose source code is excluded from the Corresponding Source as a System Library, need not be included in conveying the object code work.\n\n"
-"A “User Product” is either (1) a “consumer product”, which means any tangible personal property which is normally used for personal, family, or household purposes, or (2) anything designed or sold for incorporation into a dwelling. In determining whether a product is a consumer product, doubtful cases shall be resolved in favor of coverage. For a particular product received by a particular user, “normally used” refers to a typical or common use of that class of product, regardless of the status of the particular user or of the way in which the particular user actually uses, or expects or is expected to use, the product. A product is a consumer product regardless of whether the product has substantial commercial, industrial or non-consumer uses, unless such uses represent the only significant mode of use of the product.\n\n"
-"“Installation Information” for a User Product means any methods, procedures, authorization keys, or other information required to install and execute modified versions of a covered work in that User Product from a modified version of its Corresponding Source. The information must suffice to ensure that the continued functioning of the modified object code is in no case prevented or interfered with solely because modification has been made.\n\n"
-"If you convey an object code work under this section in, or with, or specifically for use in, a User Product, and the conveying occurs as part of a transaction in which the right of possession and use of the User Product is transferred to the recipient in perpetuity or for a fixed term (regardless of how the transaction is characterized), the Corresponding Source conveyed under this section must be accompanied by the Installation Information. But this requirement does not apply if neither you nor any third party retains the ability to install modified object code on the User Product (for example, the work has been installed in ROM).\n\n"
-"The requirement to provide Installation Information does not include a requirement to continue to provide support service, warranty, or updates for a work that has been modified or installed by the recipient, or for the User Product in which it has been modified or installed. Access to a network may be denied when the modification itself materially and adversely affects the operation of the network or violates the rules and protocols for communication across the network.\n\n"
-"Corresponding Source conveyed, and Installation Information provided, in accord with this section must be in a format that is publicly documented (and with an implementation available to the public in source code form), and must require no special password or key for unpacking, reading or copying.\n\n"
-"7. Additional Terms.\n\n"
-"“Additional permissions” are terms that supplement the terms of this License by making exceptions from one or more of its conditions. Additional permissions that are applicable to the entire Program shall be treated as though they were included in this License, to the extent that they are valid under applicable law. If additional permissions apply only to part of the Program, that part may be used separately under those permissions, but the entire Program remains governed by this License without regard to the additional permissions.\n\n"
-"When you convey a copy of a covered work, you may at your option remove any additional permissions from that copy, or from any part of it. (Additional permissions may be written to require their own removal in certain cases when you modify the work.) You may place additional permissions on material, added by you to a covered work, for which you have or can give appropriate copyright permission.\n\n"
-"Notwithstanding any other provision of this License, for material you add to a covered work, you may (if authorized by the copyright holders of that material) supplement the terms of this License with terms:\n\n"
-"    a) Disclaiming warranty or limiting liability differently from the terms of sections 15 and 16 of this License; or\n\n"
-"    b) Requiring preservation of specified reasonable legal notices or author attributions in that material or in the Appropriate Legal Notices displayed by works containing it; or\n\n"
-"    c) Prohibiting misrepresentation of the origin of that material, or requiring that modified versions of such material be marked in reasonable ways as different from the original version; or\n\n"
-"    d) Limiting the use for publicity purposes of names of licensors or authors of the material; or\n\n"
-"    e) Declining to grant rights under trademark law for use of some trade names, trademarks, or service marks; or\n\n"
-"    f) Requiring indemnification of licensors and authors of that material by anyone who conveys the material (or modified versions of it) with contractual assumptions of liability to the recipient, for any liability that these contractual assumptions directly impose on those licensors and authors.\n\n"
-"All other non-permissive additional terms are considered “further restrictions” within the meaning of section 10. If the Program as you received it, or any part of it, contains a notice stating that it is governed by this License along with a term that is a further restriction, you may remove that term. If a license document contains a further restriction but permits relicensing or conveying under this License, you may add to a covered work material governed by the terms of that license document, provided that the further restriction does not survive such relicensing or conveying.\n\n"
-"If you add terms to a covered work in accord with this section, you must place, in the relevant source files, a statement of the additional terms that apply to those files, or a notice indicating where to find the applicable terms.\n\n"
-"Additional terms, permissive or non-permissive, may be stated in the form of a separately written license, or stated as exceptions; the above requirements apply either way.\n\n"
-"8. Termination.\n\n"
-"You may not propagate or modify a covered work except as expressly provided under this License. Any attempt otherwise to propagate or modify it is void, and will automatically terminate your rights under this License (including any patent licenses granted under the third paragraph of section 11).\n\n"
-"However, if you cease all violation of this License, then your license from a particular copyright holder is reinstated (a) provisionally, unless and until the copyright holder explicitly and finally terminates your license, and (b) permanently, if the copyright holder fails to notify you of the violation by some reasonable means prior to 60 days after the cessation.\n\n"
-"Moreover, your license from a particular copyright holder is reinstated permanently if the copyright holder notifies you of the violation by some reasonable means, this is the first time you have received notice of violation of this License (for any work) from that copyright holder, and you cure the violation prior to 30 days after your receipt of the notice.\n\n"
-"Termination of your rights under this section does not terminate the licenses of parties who have received copies or rights from you under this License. If your rights have been terminated and not permanently reinstated, you do not qualify to receive new licenses for the same material under section 10.\n\n"
-"9. Acceptance Not Required for Having Copies.\n\n"
-"You are not required to accept this License in order to receive or run a copy of the Program. Ancillary propagation of a covered work occurring solely as a consequence of using peer-to-peer transmission to receive a copy likewise does not require acceptance. However, nothing other than this License grants you permission to propagate or modify any covered work. These actions infringe copyright if you do not accept this License. Therefore, by modifying or propagating a covered work, you indicate your acceptance of this License to do so.\n\n"
-"10. Automatic Licensing of Downstream Recipients.\n\n"
-"Each time you convey a covered work, the recipient automatically receives a license from the original licensors, to run, modify and propagate that work, subject to this License. You are not responsible for enforcing compliance by third parties with this License.\n\n"
-"An “entity transaction” is a transaction transferring control of an organization, or substantially all assets of one, or subdividing an organization, or merging organizations. If propagation of a covered work results from an entity transaction, each party to that transaction who receives a copy of the work also receives whatever licenses to the work the party's predecessor in interest had or could give under the previous paragraph, plus a right to possession of the Corresponding Source of the work from the predecessor in interest, if the predecessor has it or can get it with reasonable efforts.\n\n"
-"You may not impose any further restrictions on the exercise of the rights granted or affirmed under this License. For example, you may not impose a license fee, royalty, or other charge for exercise of rights granted under this License, and you may not initiate litigation (including a cross-claim or counterclaim in a lawsuit) alleging that any patent claim is infringed by making, using, selling, offering for sale, or importing the Program or any portion of it.\n\n"
-"11. Patents.\n\n"
-"A “contributor” is a copyright holder who authorizes use under this License of the Program or a work on which the Program is based. The work thus licensed is called the contributor's “contributor version”.\n\n"
-"A contributor's “essential patent claims” are all patent claims owned or controlled by the contributor, whether already acquired or hereafter acquired, that would be infringed by some manner, permitted by this License, of making, using, or selling its contributor version, but do not include claims that would be infringed only as a consequence of further modification of the contributor version. For purposes of this definition, “control” includes the right to grant patent sublicenses in a manner consistent with the requirements of this License.\n\n"
-"Each contributor grants you a non-exclusive, worldwide, royalty-free patent license under the contributor's essential patent claims, to make, use, sell, offer for sale, import and otherwise run, modify and propagate the contents of its contributor version.\n\n"
-"In the following three paragraphs, a “patent license” is any express agreement or commitment, however denominated, not to enforce a patent (such as an express permission to practice a patent or covenant not to sue for patent infringement). To “grant” such a patent license to a party means to make such an agreement or commitment not to enforce a patent against the party.\n\n"
-"If you convey a covered work, knowingly relying on a patent license, and the Corresponding Source of the work is not available for anyone to copy, free of charge and under the terms of this License, through a publicly available network server or other readily accessible means, then you must either (1) cause the Corresponding Source to be so available, or (2) arrange to deprive yourself of the benefit of the patent license for this particular work, or (3) arrange, in a manner consistent with the requirements of this License, to extend the patent license to downstream recipients. “Knowingly relying” means you have actual knowledge that, but for the patent license, your conveying the covered work in a country, or your recipient's use of the covered work in a country, would infringe one or more identifiable patents in that country that you have reason to believe are valid.\n\n"
-"If, pursuant to or in connection with a single transaction or arrangement, you convey, or propagate by procuring conveyance of, a covered work, and grant a patent license to some of the parties receiving the covered work authorizing them to use, propagate, modify or convey a specific copy of the covered work, then the patent license you grant is automatically extended to all recipients of the covered work and works based on it.\n\n"
-"A patent license is “discriminatory” if it does not include within the scope of its coverage, prohibits the exercise of, or is conditioned on the non-exercise of one or more of the rights that are specifically granted under this License. You may not convey a covered work if you are a party to an arrangement with a third party that is in the business of distributing software, under which you make payment to the third party based on the extent of your activity of conveying the work, and under which the third party grants, to any of the parties who would receive the covered work from you, a discriminatory patent license (a) in connection with copies of the covered work conveyed by you (or copies made from those copies), or (b) primarily for and in connection with specific products or compilations that contain the covered work, unless you entered into that arrangement, or that patent license was granted, prior to 28 March 2007.\n\n"
-"Nothing in this License shall be construed as excluding or limiting any implied license or other defenses to infringement that may otherwise be available to you under applicable patent law.\n\n"
-"12. No Surrender of Others' Freedom.\n\n"
-"If conditions are imposed on you (whether by court order, agreement or otherwise) that contradict the conditions of this License, they do not excuse you from the conditions of this License. If you cannot convey a covered work so as to satisfy simultaneously your obligations under this License and any other pertinent obligations, then as a consequence you may not convey it at all. For example, if you agree to terms that obligate you to collect a royalty for further conveying from those to whom you convey the Program, the only way you could satisfy both those terms and this License would be to refrain entirely from conveying the Program.\n\n"
-"13. Use with the GNU Affero General Public License.\n\n"
-"Notwithstanding any other provision of this License, you have permission to link or combine any covered work with a work licensed under version 3 of the GNU Affero General Public License into a single combined work, and to convey the resulting work. The terms of this License will continue to apply to the part which is the covered work, but the special requirements of the GNU Affero General Public License, section 13, concerning interaction through a network will apply to the combination as such.\n\n"
-"14. Revised Versions of this License.\n\n"
-"The Free Software Foundation may publish revised and/or new versions of the GNU General Public License from time to time. Such new versions will be similar in spirit to the present version, but may differ in detail to address new problems or concerns.\n\n"
-"Each version is given a distinguishing version number. If the Program specifies that a certain numbered version of the GNU General Public License “or any later version” applies to it, you have the option of following the terms and conditions either of that numbered version or of any later version published by the Free Software Foundation. If the Program does not specify a version number of the GNU General Public License, you may choose any version ever published by the Free Software Foundation.\n\n"
-"If the Program specifies that a proxy can decide which future versions of the GNU General Public License can be used, that proxy's public statement of acceptance of a version permanently authorizes you to choose that version for the Program.\n\n"
-"Later license versions may give you additional or different permissions. However, no additional obligations are imposed on any author or copyright holder as a result of your choosing to follow a later version.\n\n"
-"15. Disclaimer of Warranty.\n\n"
-"THERE IS NO WARRANTY FOR THE PROGRAM, TO THE EXTENT PERMITTED BY APPLICABLE LAW. EXCEPT WHEN OTHERWISE STATED IN WRITING THE COPYRIGHT HOLDERS AND/OR OTHER PARTIES PROVIDE THE PROGRAM “AS IS” WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE ENTIRE RISK AS TO THE QUALITY AND PERFORMANCE OF THE PROGRAM IS WITH YOU. SHOULD THE PROGRAM PROVE DEFECTIVE, YOU ASSUME THE COST OF ALL NECESSARY SERVICING, REPAIR OR CORRECTION.\n\n"
-"16. Limitation of Liability.\n\n"
-"IN NO EVENT UNLESS REQUIRED BY APPLICABLE LAW OR AGREED TO IN WRITING WILL ANY COPYRIGHT HOLDER, OR ANY OTHER PARTY WHO MODIFIES AND/OR CONVEYS THE PROGRAM AS PERMITTED ABOVE, BE LIABLE TO YOU FOR DAMAGES, INCLUDING ANY GENERAL, SPECIAL, INCIDENTAL OR CONSEQUENTIAL DAMAGES ARISING OUT OF THE USE OR INABILITY TO USE THE PROGRAM (INCLUDING BUT NOT LIMITED TO LOSS OF DATA OR DATA BEING RENDERED INACCURATE OR LOSSES SUSTAINED BY YOU OR THIRD PARTIES OR A FAILURE OF THE PROGRAM TO OPERATE WITH ANY OTHER PROGRAMS), EVEN IF SUCH HOLDER OR OTHER PARTY HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.\n\n"
-"17. Interpretation of Sections 15 and 16.\n\n"
-"If the disclaimer of warranty and limitation of liability provided above cannot be given local legal effect according to their terms, reviewing courts shall apply local law that most closely approximates an absolute waiver of all civil liability in connection with the Program, unless a warranty or assumption of liability accompanies a copy of the Program in return for a fee.\n\n"
-"END OF TERMS AND CONDITIONS\n\n"
-"How to Apply These Terms to Your New Programs\n\n"
-"If you develop a new program, and you want it to be of the greatest possible use to the public, the best way to achieve this is to make it free software which everyone can redistribute and change under these terms.\n\n"
-"To do so, attach the following notices to the program. It is safest to attach them to the start of each source file to most effectively state the exclusion of warranty; and each file should have at least the “copyright” line and a pointer to where the full notice is found.\n\n"
-"XorgIdleManager: a utility designed to manage system sleep or shutdown based on inactivity in X11 environments.\n"
-"Copyright (C) 2025 Maksym Nazar.\n"
-"Created with the assistance of Perplexity, ChatGPT, and Claude.\n\n"
-"This program is free software: you can redistribute it and/or modify\n"
-"it under the terms of the GNU General Public License as published by\n"
-"the Free Software Foundation, either version 3 of the License, or\n"
-"(at your option) any later version.\n\n"
-"This program is distributed in the hope that it will be useful,\n"
-"but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
-"MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
-"GNU General Public License for more details.\n\n"
-"You should have received a copy of the GNU General Public License\n"
-"along with this program.  If not, see <https://www.gnu.org/licenses/>.\n\n"
-"For inquiries, please contact us at:\n"
-"Email: maximkursua@gmail.com\n";
-
-    GtkWidget *license_dialog;
-    GtkWidget *content_area;
-    GtkWidget *scrolled_window;
-    GtkWidget *text_view;
-    GtkTextBuffer *buffer;
-
-    license_dialog = gtk_dialog_new_with_buttons("License Information",
-                                                 GTK_WINDOW(gtk_widget_get_toplevel(widget)),
-                                                 GTK_DIALOG_MODAL,
-                                                 "Close", GTK_RESPONSE_CLOSE,
-                                                 NULL);
+static void run_apply_job(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+    struct apply_job *job = task_data;
+    size_t size = sizeof(job->messages[0]);
 
-    content_area = gtk_dialog_get_content_area(GTK_DIALOG(license_dialog));
-    scrolled_window = gtk_scrolled_window_new(NULL, NULL);
-    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled_window),
-                                   GTK_POLICY_AUTOMATIC,
-                                   GTK_POLICY_AUTOMATIC);
-    gtk_widget_set_size_request(scrolled_window, 640, 400);
+    report_apply_stage(APPLY_STAGE_CONFIG);
+    if (!write_config_file(job->config_text, job->config_length, job->messages[APPLY_STAGE_CONFIG], size)) {
+        job->failed = 1;
+        g_task_return_boolean(task, FALSE);
+        return;
+    }
+    snprintf(job->messages[APPLY_STAGE_CONFIG], size, "Configuration saved.");
 
-    gtk_widget_set_hexpand(scrolled_window, TRUE);
-    gtk_widget_set_vexpand(scrolled_window, TRUE);
+    report_apply_stage(APPLY_STAGE_DPMS);
+    Display *display = job->display_name[0] ? XOpenDisplay(job->display_name) : NULL;
+    if (display == NULL) {
+        snprintf(job->messages[APPLY_STAGE_DPMS], size, "DPMS was not changed: no X display.");
+    } else {
+        if (apply_dpms_settings(display, job->dpms_enabled, job->dpms_standby, job->dpms_suspend, job->dpms_off,
+                                job->messages[APPLY_STAGE_DPMS], size)) {
+            snprintf(job->messages[APPLY_STAGE_DPMS], size, "DPMS applied.");
+        } else {
+            job->failed = 1;
+        }
+        XCloseDisplay(display);
+    }
 
-    text_view = gtk_text_view_new();
-    gtk_text_view_set_editable(GTK_TEXT_VIEW(text_view), FALSE);
-    gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(text_view), GTK_WRAP_WORD_CHAR);
-    gtk_text_view_set_left_margin(GTK_TEXT_VIEW(text_view), 20);
-    gtk_text_view_set_right_margin(GTK_TEXT_VIEW(text_view), 20);
+    report_apply_stage(APPLY_STAGE_DAEMON);
+    if (!apply_config_to_daemon(job->messages[APPLY_STAGE_DAEMON], size, &job->daemon_started)) {
+        job->failed = 1;
+    }
+    g_task_return_boolean(task, !job->failed);
+}
 
-    buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view));
-    gtk_text_buffer_set_text(buffer, license_text, -1);
+static void on_apply_job_finished(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+    struct apply_job *job = g_task_get_task_data(G_TASK(result));
+    char text[sizeof(job->messages)];
+    size_t used = 0;
+    text[0] = '\0';
+    for (int stage = 0; stage < APPLY_STAGES; stage++) {
+        if (job->messages[stage][0] != '\0') {
+            used += snprintf(text + used, sizeof(text) - used, "%s%s", used ? " " : "", job->messages[stage]);
+        }
+    }
+    gtk_label_set_text(GTK_LABEL(apply_progress_label), text);
+    gtk_widget_set_sensitive(save_button, TRUE);
 
-    gtk_container_add(GTK_CONTAINER(scrolled_window), text_view);
-    gtk_container_add(GTK_CONTAINER(content_area), scrolled_window);
+    if (job->daemon_started) {
+        status_subscribe_attempts = 0;
+        g_timeout_add(500, retry_status_subscription, NULL);
+    }
+    if (!g_task_propagate_boolean(G_TASK(result), NULL)) {
+        show_error(text);
+    }
+}
 
-    gtk_widget_show_all(license_dialog);
+void start_apply_job(void) {
+    struct apply_job *job = calloc(1, sizeof(*job));
+    if (job == NULL || (job->config_text = format_config(&job->config_length)) == NULL) {
+        free(job);
+        show_error("Failed to prepare the configuration.");
+        return;
+    }
+    Display *display = window_xdisplay();
+    if (display != NULL) {
+        snprintf(job->display_name, sizeof(job->display_name), "%s", DisplayString(display));
+    }
+    job->dpms_enabled = dpms_enabled;
+    job->dpms_standby = dpms_standby;
+    job->dpms_suspend = dpms_suspend;
+    job->dpms_off = dpms_off;
+
+    gtk_widget_set_sensitive(save_button, FALSE);
+    GTask *task = g_task_new(NULL, NULL, on_apply_job_finished, NULL);
+    g_task_set_task_data(task, job, free_apply_job);
+    g_task_run_in_thread(task, run_apply_job);
+    g_object_unref(task);
+}
 
-    gtk_dialog_run(GTK_DIALOG(license_dialog));
-    gtk_widget_destroy(license_dialog);
+GtkWidget *create_button(const char *label, GCallback callback) {
+    GtkWidget *button = gtk_button_new_with_label(label);
+    g_signal_connect(button, "clicked", callback, NULL);
+    return button;
 }
 
-void show_usage_terms(GtkWidget *widget, gpointer data) {
-    const char *terms_text = "TERMS OF USE\n\n"
-"1. Usage:\n"
-"You are granted a non-exclusive, non-transferable license to use the Program under the terms of the GNU General Public License (GPL) Version 3.0. The term \"Program\" refers to the software package or product distributed under this License. You may use, copy, modify, and distribute the Program freely, provided that all copies and derivative works are licensed under the GPL and include this license notice.\n\n"
-"2. License:\n"
-"This Program is licensed under the GNU General Public License (GPL) Version 3.0, which ensures that users have the freedom to run, study, share, and modify the software. A copy of the GPL license is included with the Program package, or you can access it at https://www.gnu.org/licenses/gpl-3.0.html.\n\n"
-"3. Source Code Availability:\n"
-"As required by the GNU General Public License (GPL), the full source code of this Program is available and can be obtained from the official repository or package distribution. If you did not receive a copy of the source code, you may request it from the developer. Additionally, you have the right to access and modify the source code under the terms of this License.\n\n"
-"4. Disclaimer of Warranties:\n"
-"The Program is provided \"as is,\" without any warranties, express or implied, including but not limited to the implied warranties of merchantability or fitness for a particular purpose. The developers make no representations or warranties regarding the use or performance of the Program.\n\n"
-"5. Limitation of Liability:\n"
-"In no event shall the developers be liable for any direct, indirect, incidental, special, exemplary, or consequential damages, including but not limited to damages for loss of data or profit, arising out of or in connection with the use of or inability to use the Program, even if advised of the possibility of such damages.\n\n"
-"6. Modifications to the Program:\n"
-"You may modify and distribute modified versions of the Program, provided you comply with the terms of the GNU General Public License (GPL). The developers reserve the right to modify, update, or discontinue the Program at their discretion.\n\n"
-"7. Compliance with Laws:\n"
-"You are responsible for complying with all applicable local, state, national, and international laws in connection with your use of the Program.\n\n"
-"8. Copyright:\n"
-"Copyright (C) 2025 Maksym Nazar.\n"
-"Created with the assistance of Perplexity, ChatGPT, and Claude.\n"
-"This work is licensed under the GNU General Public License (GPL) Version 3.0.\n\n"
-"9. Contact:\n"
-"For inquiries, please contact us at:\n"
-"Email: maximkursua@gmail.com\n";
-
-    GtkWidget *terms_dialog;
+/*
+ * The license, terms and help dialogs are built the first time they are opened and hidden,
+ * not destroyed, when closed, so they cost nothing at startup and are only built once.
+ */
+static GtkWidget *create_text_dialog(const char *title, GtkWidget *widget, const char *text, gssize length) {
+    GtkWidget *dialog;
     GtkWidget *content_area;
     GtkWidget *scrolled_window;
     GtkWidget *text_view;
     GtkTextBuffer *buffer;
 
-    terms_dialog = gtk_dialog_new_with_buttons("Terms of Use",
-                                               GTK_WINDOW(gtk_widget_get_toplevel(widget)),
-                                               GTK_DIALOG_MODAL,
-                                               "Close", GTK_RESPONSE_CLOSE,
-                                               NULL);
+    dialog = gtk_dialog_new_with_buttons(title,
+                                         GTK_WINDOW(gtk_widget_get_toplevel(widget)),
+                                         GTK_DIALOG_MODAL,
+                                         "Close", GTK_RESPONSE_CLOSE,
+                                         NULL);
 
-    content_area = gtk_dialog_get_content_area(GTK_DIALOG(terms_dialog));
+    content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
     scrolled_window = gtk_scrolled_window_new(NULL, NULL);
     gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled_window),
                                    GTK_POLICY_AUTOMATIC,
@@ -1324,45 +5932,90 @@ void show_usage_terms(GtkWidget *widget, gpointer data) {
     gtk_text_view_set_right_margin(GTK_TEXT_VIEW(text_view), 20);
 
     buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view));
-    gtk_text_buffer_set_text(buffer, terms_text, -1);
+    gtk_text_buffer_set_text(buffer, text, length);
 
     gtk_container_add(GTK_CONTAINER(scrolled_window), text_view);
     gtk_container_add(GTK_CONTAINER(content_area), scrolled_window);
+    gtk_widget_show_all(content_area);
+    return dialog;
+}
+
+static GtkWidget *create_resource_dialog(const char *title, GtkWidget *widget, const char *name) {
+    char path[128];
+    snprintf(path, sizeof(path), RESOURCE_PATH "%s", name);
+    GBytes *bytes = g_resources_lookup_data(path, G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
+    if (bytes == NULL) {
+        char text[128];
+        snprintf(text, sizeof(text), "%s is not included in this build.", name);
+        return create_text_dialog(title, widget, text, -1);
+    }
+
+    gsize length;
+    const char *text = g_bytes_get_data(bytes, &length);
+    while (length > 0 && *text == '\n') {
+        text++;
+        length--;
+    }
+    GtkWidget *dialog = create_text_dialog(title, widget, text, length);
+    g_bytes_unref(bytes);
+    return dialog;
+}
+
+static void run_cached_dialog(GtkWidget *dialog) {
+    gtk_dialog_run(GTK_DIALOG(dialog));
+    gtk_widget_hide(dialog);
+}
 
-    gtk_widget_show_all(terms_dialog);
+void show_license_info(GtkWidget *widget, gpointer data) {
+    static GtkWidget *license_dialog = NULL;
+    if (license_dialog == NULL) {
+        license_dialog = create_resource_dialog("License Information", widget, "LICENSE.txt");
+    }
+    run_cached_dialog(license_dialog);
+}
 
-    gtk_dialog_run(GTK_DIALOG(terms_dialog));
-    gtk_widget_destroy(terms_dialog);
+void show_usage_terms(GtkWidget *widget, gpointer data) {
+    static GtkWidget *terms_dialog = NULL;
+    if (terms_dialog == NULL) {
+        terms_dialog = create_resource_dialog("Terms of Use", widget, "TERMS_OF_USE.txt");
+    }
+    run_cached_dialog(terms_dialog);
 }
 
 void generate_shell_command(GtkWidget *widget, gpointer data) {
-    char command[MAX_COMMAND_LENGTH * 2];
+    char command[PATH_MAX + MAX_COMMAND_LENGTH * 14];
     char executable_path[PATH_MAX];
-    char *last_slash;
 
     if (realpath("/proc/self/exe", executable_path) == NULL) {
         perror("Error getting executable path");
         return;
     }
 
-    last_slash = strrchr(executable_path, '/');
-    if (last_slash != NULL) {
-        *last_slash = '\0';
-    }
-
-    char script_path[PATH_MAX];
-    snprintf(script_path, sizeof(script_path), "%s/XorgIdleManager_daemon.sh", executable_path);
-
     snprintf(command, sizeof(command), 
-        "\"%s\" --inactivity-timeout %d --long-running-apps-timeout %d --check-interval %d "
+        "\"%s\" --daemon --inactivity-timeout %d --long-running-apps-timeout %d --check-interval %d "
         "--cpu-threshold %d --io-threshold %d --net-threshold %d --cpu-net-check-interval %d "
+        "--cpu-exit-threshold %d --io-exit-threshold %d --net-exit-threshold %d --ewma-weight %d --min-dwell-time %d "
         "--io-check-interval %d --action-type %d --sleep-command '%s' --shutdown-command '%s' "
-        "--custom-long-running-apps '%s'",
-        script_path,
+        "--cpu-policy %d --cpu-top-cores %d --io-devices-include '%s' --io-devices-exclude '%s' "
+        "--net-interfaces-include '%s' --net-interfaces-exclude '%s' --net-kinds-exclude '%s' "
+        "--activity-denylist '%s' --activity-allowlist '%s' --log-level %d "
+        "--cgroups-include '%s' --cgroups-exclude '%s' --cgroup-cpu-threshold %d --cgroup-io-threshold %d "
+        "--activity-source %d --psi-cpu-threshold %d --psi-io-threshold %d --psi-average %d --psi-trigger-ms %d "
+        "--activity-window %d --sample-interval %d --activity-statistic %d --activity-busy-percent %d "
+        "--custom-long-running-apps '%s' --home '%s'",
+        executable_path,
         inactivity_timeout, long_running_apps_timeout, check_interval,
         cpu_threshold, io_threshold, net_threshold, 
-        cpu_net_check_interval, io_check_interval, 
-        action_type, sleep_command, shutdown_command, custom_long_running_apps);
+        cpu_net_check_interval, cpu_exit_threshold, io_exit_threshold, net_exit_threshold, ewma_weight, min_dwell_time,
+        io_check_interval, 
+        action_type, sleep_command, shutdown_command,
+        cpu_policy, cpu_top_cores, io_devices_include, io_devices_exclude,
+        net_interfaces_include, net_interfaces_exclude, net_kinds_exclude,
+        activity_denylist, activity_allowlist, log_level,
+        cgroups_include, cgroups_exclude, cgroup_cpu_threshold, cgroup_io_threshold,
+        activity_source, psi_cpu_threshold, psi_io_threshold, psi_average, psi_trigger_ms,
+        activity_window, sample_interval, activity_statistic, activity_busy_percent,
+        custom_long_running_apps, getenv("HOME"));
 
     GtkWidget *dialog;
     GtkWidget *content_area;
@@ -1401,7 +6054,13 @@ void generate_shell_command(GtkWidget *widget, gpointer data) {
 }
 
 void show_help_and_info(GtkWidget *widget, gpointer data) {
-    const char *info = "XorgIdleManager v1.6: Purpose and Usage\n\n"
+    static GtkWidget *help_dialog = NULL;
+    if (help_dialog != NULL) {
+        run_cached_dialog(help_dialog);
+        return;
+    }
+
+    const char *info = "XorgIdleManager v1.7: Purpose and Usage\n\n"
                        "======================== Purpose: ========================\n"
                        "XorgIdleManager is designed to manage system sleep or shutdown based on inactivity in X11 environments.\n\n"
                        "======================= How it works: ======================\n"
@@ -1412,17 +6071,29 @@ void show_help_and_info(GtkWidget *widget, gpointer data) {
                        "- Inactivity Timeout: The time (in seconds) of overall user inactivity after which the system will perform the selected action (sleep or shutdown).\n"
                        "- Long-Running Applications Timeout: A separate timeout (in seconds) for when any of the specified long-running applications are active. This overrides the general inactivity timeout.\n"
                        "- Custom Long-Running Applications: List of processes (separated by '|') that will use the special Long-Running Applications Timeout. This can include media players, torrent clients, video editors, or any other applications that require extended periods of inactivity.\n"
-                       "- Check Interval: The main interval (in seconds) at which the program performs its overall inactivity check. For example, if set to 3600 seconds (1 hour), the program will run a complete check every hour.\n"
+                       "  Each entry is an exact process name (vlc), a prefix (firefox*), a glob (*player), or re: followed by an extended regular expression matched against the full command line (re:python3 .*jupyter). Write \\| for a literal '|' inside an entry.\n"
+                       "- Check Interval: The fallback interval (in seconds) between inactivity checks. When the X server supports the XSync IDLETIME counter, the daemon is woken by the X server exactly when the timeout is reached and when the user returns, so this interval only matters while the system stays busy after the timeout or when no X server is available.\n"
                        "- CPU Threshold: The percentage of CPU usage above which the system is considered active.\n"
+                       "  Which usage is compared is set by cpu_policy in config.ini: 0 compares the whole-system average (default), 1 triggers when any single core is above the threshold, and 2 averages the cpu_top_cores busiest cores. Policies 1 and 2 keep many-core machines awake during single-threaded work such as a long link step.\n"
                        "- I/O Threshold: The amount of disk I/O activity (in KB/s) above which the system is considered active.\n"
+                       "  Disk activity is read from /proc/diskstats per device. io_devices_include and io_devices_exclude in config.ini take '|'-separated glob patterns (for example sd*|nvme*); by default loop, ram, zram, device-mapper and md devices are excluded because their traffic is already counted on the underlying disks. A partition is only counted separately when its whole disk is not.\n"
                        "- Network Threshold: The amount of network activity (in KB/s) above which the system is considered active.\n"
+                       "  Network traffic is read per interface over rtnetlink. net_interfaces_include and net_interfaces_exclude in config.ini take '|'-separated glob patterns of interface names, and net_kinds_exclude takes patterns of link kinds (bridge, veth, tun, wireguard, vlan, bond, ...). By default loopback and every virtual link are skipped, so container bridges and VPN tunnels do not count the same bytes twice. When net_interfaces_include is set, exactly the matching interfaces are counted regardless of their kind.\n"
+                       "- Process attribution: activity_denylist in config.ini lists processes whose CPU time and disk I/O are not counted (by default file indexers and package-cache refreshes such as updatedb, baloo_file, tracker-miner-fs and packagekitd); the daemon's own usage is never counted. activity_allowlist does the reverse: when set, only the listed processes (for example cc1*|ld|rsync) count towards CPU and I/O activity. Both use the Custom Long-Running Applications syntax. Disk I/O can only be attributed to processes of the same user. When system activity prevents an action, the log and the status name the process that used the most CPU (or I/O).\n"
+                       "- cgroup probe: on systemd hosts, cgroups_include in config.ini selects cgroup v2 groups below /sys/fs/cgroup whose CPU time (cpu.stat) and disk I/O (io.stat) are watched on their own, and cgroups_exclude takes groups below them out again. Both are '|'-separated paths with glob patterns, %U stands for your user id and / for the whole system; for example user.slice/user-%U.slice for only your own session, or / with system.slice/packagekit.service excluded. cgroup_cpu_threshold (% of all CPUs) and cgroup_io_threshold (KB/s) count as system activity like the CPU and I/O thresholds. The probe is off while cgroups_include is empty.\n"
+                       "- Pressure stall information: with activity_source=1 in config.ini, CPU and I/O activity are judged by the kernel's PSI averages (/proc/pressure/cpu, io and memory: the share of time tasks were stalled waiting for CPU, I/O or memory) instead of sampling counters, so a decision no longer waits for a second sample. psi_average picks the 10, 60 or 300 second average; psi_cpu_threshold and psi_io_threshold are in percent, and memory stalls count as I/O. psi_trigger_ms (0 to disable) registers kernel triggers that wake the daemon when tasks stall that many milliseconds within 2 seconds, marking the system active at once. Network traffic is then measured between two decisions. Without PSI support in the kernel the counters are used.\n"
+                       "- CPU/I/O/Network Exit Threshold: Each signal switches from idle to active above its threshold and back to idle only below its exit threshold, so a machine hovering around a threshold does not flap between the two. An exit threshold above the threshold is treated as equal to it.\n"
+                       "- Smoothing Weight: Measurements are smoothed with an exponentially weighted average before they are compared; each new measurement contributes this percentage. 100 disables smoothing.\n"
+                       "- Minimum Dwell Time: A signal only switches between active and idle after the smoothed value has stayed past the relevant threshold for this many seconds. Switches are logged as events.\n"
                        "- CPU/Net Check Interval: The interval (in seconds) between two measurements of CPU and network activity.\n"
                        "- I/O Check Interval: The duration (in seconds) for which disk I/O activity is measured.\n"
+                       "  These two intervals are only used when activity_window in config.ini is 0. Then CPU, I/O and network are measured together over one shared window whose length is the larger of these two intervals, and the decision waits for it.\n"
+                       "  By default the daemon instead samples activity every sample_interval seconds (default 2) during the activity_window seconds (default 30) before a decision is due, and decides at once from that window. activity_statistic picks what is compared with each threshold: 0 the average (default), 1 the maximum, 2 the 95th percentile. With activity_busy_percent above 0, a signal counts as active when it was above its threshold for more than that percentage of the window (for example activity_window=600 and activity_busy_percent=20 means busy for 20% of the last 10 minutes).\n"
                        "- Boot Grace Period: The time (in minutes) after system boot during which no actions will be performed by the idle manager. This prevents unintended sleep or shutdown immediately after boot if XorgIdleManager_Daemon is set to autostart.\n"
                        "- DPMS Enable: Enable or disable DPMS (Display Power Management Signaling).\n"
                        "- DPMS Standby: Time in seconds before the monitor enters standby mode.\n"
                        "- DPMS Suspend: Time in seconds before the monitor enters suspend mode.\n"
-                       "- DPMS Off: Time in seconds before the monitor turns off.\n\n"
+                       "- DPMS Off: Time in seconds before the monitor turns off.\nDPMS timeouts range from 0 to 65535 seconds; 0 disables that stage, and non-zero values must not decrease from Standby to Suspend to Off.\n\n"
                        "======================== Actions: ========================\n"
                        "- Sleep Command: This can be a single command or a macro command (a sequence of commands) executed to put the system into sleep mode while running in an X server environment. These include a default macro command provided by XorgIdleManager, which users can replace with their own custom command or macro command, if needed.\n"
                        "- Shutdown Command: Similarly, this can be either a single command or a macro command executed to shut down the system while running in an X server environment. Users can rely on the default option provided by XorgIdleManager or customize it, if needed.\n"
@@ -1432,49 +6103,16 @@ void show_help_and_info(GtkWidget *widget, gpointer data) {
                        "======== Running the Background Process With Custom Parameters: ========\n"
                        "To run the background daemon process with parameters other than those defined by the user in the configuration, use the \"Generate Daemon Command\" function. This function allows you to create a command for starting the daemon with custom parameters. Modify the necessary parameters in the generated command and execute it in the terminal.\n\n"
                        "=============== Autostarting the Background Process: ===============\n"
-                       "You can add the background daemon process to your system's startup script or autostart configuration file. The daemon does not require a GUI to operate and will run independently in the background. If you need to use custom parameters for autostart, apply the \"Generate Daemon Command\" function to create a command that suits your needs and include it in your autostart configuration.\n\n"
+                       "You can add the background daemon process to your system's startup script or autostart configuration file. The daemon is the XorgIdleManager binary itself started with the --daemon option; it reads the saved configuration directly and does not require a GUI to operate and will run independently in the background. If you need to use custom parameters for autostart, apply the \"Generate Daemon Command\" function to create a command that suits your needs and include it in your autostart configuration.\n\n"
                        "====================== Notes for Users ======================\n"
-                       "1. Please be aware that the actual execution of sleep and shutdown commands may not occur exactly at the specified Inactivity Timeout (or Long-Running Applications Timeout) and Check Interval. The program performs additional checks, specifically CPU/Net Check Interval and I/O Check Interval, which take time as defined in the settings. Additionally, the overall system load and speed can affect the timing. Therefore, the actual time before action may be longer than the set parameters.\n"
-                       "2. The program automatically determines and saves the user's home directory in the configuration file when using \"Save and Apply.\" This ensures that scripts launched before user authorization (e.g., during system autostart) work correctly even if the system's dynamic HOME variable is not yet initialized. Such functionality prevents potential issues with script execution in environments where user-specific variables are not yet set.\n";
-
-
-    GtkWidget *dialog;
-    GtkWidget *content_area;
-    GtkWidget *scrolled_window;
-    GtkWidget *text_view;
-    GtkTextBuffer *buffer;
-
-    dialog = gtk_dialog_new_with_buttons("Help and Information",
-                                         GTK_WINDOW(gtk_widget_get_toplevel(widget)),
-                                         GTK_DIALOG_MODAL,
-                                         "Close", GTK_RESPONSE_CLOSE,
-                                         NULL);
-
-    content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-    scrolled_window = gtk_scrolled_window_new(NULL, NULL);
-    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled_window),
-                                   GTK_POLICY_AUTOMATIC,
-                                   GTK_POLICY_AUTOMATIC);
-    gtk_widget_set_size_request(scrolled_window, 640, 400);
-
-    gtk_widget_set_hexpand(scrolled_window, TRUE);
-    gtk_widget_set_vexpand(scrolled_window, TRUE);
-
-    text_view = gtk_text_view_new();
-    gtk_text_view_set_editable(GTK_TEXT_VIEW(text_view), FALSE);
-    gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(text_view), GTK_WRAP_WORD_CHAR);
-    gtk_text_view_set_left_margin(GTK_TEXT_VIEW(text_view), 20);
-    gtk_text_view_set_right_margin(GTK_TEXT_VIEW(text_view), 20);
-
-    buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view));
-    gtk_text_buffer_set_text(buffer, info, -1);
-
-    gtk_container_add(GTK_CONTAINER(scrolled_window), text_view);
-    gtk_container_add(GTK_CONTAINER(content_area), scrolled_window);
-    gtk_widget_show_all(dialog);
-
-    gtk_dialog_run(GTK_DIALOG(dialog));
-    gtk_widget_destroy(dialog);
+                       "1. Please be aware that the actual execution of sleep and shutdown commands may not occur exactly at the specified Inactivity Timeout (or Long-Running Applications Timeout) and Check Interval. When activity_window is 0, the program performs additional checks over a single window as long as the larger of CPU/Net Check Interval and I/O Check Interval. Additionally, the overall system load and speed can affect the timing. Therefore, the actual time before action may be longer than the set parameters.\n"
+                       "2. The program automatically determines and saves the user's home directory in the configuration file when using \"Save and Apply.\" This ensures that scripts launched before user authorization (e.g., during system autostart) work correctly even if the system's dynamic HOME variable is not yet initialized. Such functionality prevents potential issues with script execution in environments where user-specific variables are not yet set.\n"
+                       "3. The daemon writes its log to ~/.XorgIdleManager/xorg-idle-manager.log and keeps two older files (.1 and .2). log_level in config.ini sets how much is written: 0 errors only, 1 adds warnings, 2 adds startup and actions taken (default), 3 adds every probe and decision step. Sending SIGUSR1 to the daemon writes its current state to the log.\n"
+                       "4. Every check is also recorded in ~/.XorgIdleManager/samples.ring (the last 65536 checks: idle time, CPU, I/O and network rates, PSI stall percentages when activity_source=1, and the decision taken). Run XorgIdleManager --samples --since -2h [--until TIME] [--format csv|json] to export them.\n"
+                       "5. XorgIdleManager --control status|stop|reload|samples [SINCE [UNTIL]] talks to the running daemon: status shows idle time, the timeout in effect and time to action, stop shuts it down cleanly, reload applies config.ini and reports whether it was accepted, and samples exports the check history.\n";
+
+    help_dialog = create_text_dialog("Help and Information", widget, info, -1);
+    run_cached_dialog(help_dialog);
 }
 
 void stop_daemon(GtkWidget *widget, gpointer data) {
@@ -1484,35 +6122,66 @@ void stop_daemon(GtkWidget *widget, gpointer data) {
         return;
     }
 
-    FILE *fp = popen("pgrep -f XorgIdleManager_daemon.sh", "r");
-    if (fp == NULL) {
-        show_info("Error checking daemon status.");
-        return;
-    }
-
-    char buffer[128];
-    if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        pclose(fp);
-
-        char command[512];
-
-        snprintf(command, sizeof(command), "kill -9 $(cat %s/.XorgIdleManager/xorg_idle_manager_pids 2>/dev/null) 2>/dev/null", home_directory);
-        system(command);
-
-        snprintf(command, sizeof(command), "rm -f %s/.XorgIdleManager/xorg_idle_manager_pids", home_directory);
-        system(command);
-
-        system("pkill -f XorgIdleManager_daemon.sh");
-
+    if (stop_running_daemon()) {
         show_info("XorgIdleManager daemon stopped.");
     } else {
-        pclose(fp);
         show_info("XorgIdleManager daemon is not running.");
     }
 }
 
+/*
+ * XorgIdleManager --bench-startup opens the window as usual, prints how long each startup phase
+ * took once the first frame has been drawn, and exits. Times are measured from main().
+ */
+enum bench_mark {
+    BENCH_MAIN,
+    BENCH_GTK_INIT,
+    BENCH_WIDGETS,
+    BENCH_SHOWN,
+    BENCH_FIRST_FRAME,
+    BENCH_MARKS
+};
+
+static int bench_startup = 0;
+static gint64 bench_marks[BENCH_MARKS];
+
+static gboolean quit_main_loop(gpointer data) {
+    gtk_main_quit();
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean on_first_frame(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    if (bench_marks[BENCH_FIRST_FRAME] != 0) {
+        return FALSE;
+    }
+    bench_marks[BENCH_FIRST_FRAME] = g_get_monotonic_time();
+    printf("gtk_init %.1f ms, widgets %.1f ms, config and show %.1f ms, first frame %.1f ms, total %.1f ms\n",
+           (bench_marks[BENCH_GTK_INIT] - bench_marks[BENCH_MAIN]) / 1000.0,
+           (bench_marks[BENCH_WIDGETS] - bench_marks[BENCH_GTK_INIT]) / 1000.0,
+           (bench_marks[BENCH_SHOWN] - bench_marks[BENCH_WIDGETS]) / 1000.0,
+           (bench_marks[BENCH_FIRST_FRAME] - bench_marks[BENCH_SHOWN]) / 1000.0,
+           (bench_marks[BENCH_FIRST_FRAME] - bench_marks[BENCH_MAIN]) / 1000.0);
+    g_idle_add(quit_main_loop, NULL);
+    return FALSE;
+}
+
 int main(int argc, char *argv[]) {
+    bench_marks[BENCH_MAIN] = g_get_monotonic_time();
+    if (argc > 1 && strcmp(argv[1], "--daemon") == 0) {
+        return run_daemon(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--samples") == 0) {
+        return run_samples_query(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--control") == 0) {
+        return run_control_command(argc, argv);
+    }
+    bench_startup = argc > 1 && strcmp(argv[1], "--bench-startup") == 0;
+
+    /* Save & Apply talks to the X server from a worker thread on a connection of its own. */
+    XInitThreads();
     gtk_init(&argc, &argv);
+    bench_marks[BENCH_GTK_INIT] = g_get_monotonic_time();
 
     GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
     gtk_window_set_title(GTK_WINDOW(window), "XorgIdleManager Configuration");
@@ -1542,6 +6211,11 @@ int main(int argc, char *argv[]) {
     cpu_threshold_entry = gtk_entry_new();
     io_threshold_entry = gtk_entry_new();
     net_threshold_entry = gtk_entry_new();
+    cpu_exit_threshold_entry = gtk_entry_new();
+    io_exit_threshold_entry = gtk_entry_new();
+    net_exit_threshold_entry = gtk_entry_new();
+    ewma_weight_entry = gtk_entry_new();
+    min_dwell_time_entry = gtk_entry_new();
     cpu_net_check_interval_entry = gtk_entry_new();
     io_check_interval_entry = gtk_entry_new();
     boot_grace_period_entry = gtk_entry_new();
@@ -1556,6 +6230,11 @@ int main(int argc, char *argv[]) {
     gtk_widget_set_hexpand(cpu_threshold_entry, TRUE);
     gtk_widget_set_hexpand(io_threshold_entry, TRUE);
     gtk_widget_set_hexpand(net_threshold_entry, TRUE);
+    gtk_widget_set_hexpand(cpu_exit_threshold_entry, TRUE);
+    gtk_widget_set_hexpand(io_exit_threshold_entry, TRUE);
+    gtk_widget_set_hexpand(net_exit_threshold_entry, TRUE);
+    gtk_widget_set_hexpand(ewma_weight_entry, TRUE);
+    gtk_widget_set_hexpand(min_dwell_time_entry, TRUE);
     gtk_widget_set_hexpand(cpu_net_check_interval_entry, TRUE);
     gtk_widget_set_hexpand(io_check_interval_entry, TRUE);
     gtk_widget_set_hexpand(boot_grace_period_entry, TRUE);
@@ -1579,6 +6258,31 @@ int main(int argc, char *argv[]) {
 
     int row = 0;
 
+    GtkWidget *status_title = gtk_label_new(NULL);
+    gtk_label_set_markup(GTK_LABEL(status_title), "<b>Daemon Status</b>");
+    gtk_widget_set_halign(status_title, GTK_ALIGN_START);
+    gtk_grid_attach(GTK_GRID(grid), status_title, 0, row, 4, 1);
+    row++;
+
+    #define ADD_STATUS_ROW(label_text, tooltip_text, value_label) \
+    { \
+        GtkWidget *label = create_label_with_tooltip(label_text, tooltip_text); \
+        value_label = gtk_label_new("-"); \
+        gtk_widget_set_halign(value_label, GTK_ALIGN_START); \
+        gtk_grid_attach(GTK_GRID(grid), label, 0, row, 1, 1); \
+        gtk_grid_attach(GTK_GRID(grid), value_label, 1, row, 3, 1); \
+        row++; \
+    }
+
+    ADD_STATUS_ROW("Daemon:", "Whether the XorgIdleManager daemon is running. This section is updated by the daemon itself whenever its state changes.", status_daemon_label)
+    ADD_STATUS_ROW("Idle Time:", "How long there has been no keyboard or mouse input.", status_idle_label)
+    ADD_STATUS_ROW("Timeout in Effect:", "The timeout the daemon applied at its last decision: the Inactivity Timeout, or the Long-Running Apps Timeout while one of those applications runs.", status_timeout_label)
+    ADD_STATUS_ROW("Long-Running App:", "A running process that matched the Custom Long-Running Applications list.", status_app_label)
+    ADD_STATUS_ROW("Activity:", "The most recent CPU, disk I/O and network measurements. (active) marks signals currently above their thresholds.", status_rates_label)
+    ADD_STATUS_ROW("Action:", "Time left until the idle timeout is reached. The action is only taken once CPU, I/O and network activity are also below their thresholds.", status_action_label)
+
+    #undef ADD_STATUS_ROW
+
     #define ADD_ENTRY_WITH_LABEL(label_text, tooltip_text, entry) \
     { \
         GtkWidget *label = create_label_with_tooltip(label_text, tooltip_text); \
@@ -1591,12 +6295,17 @@ int main(int argc, char *argv[]) {
     ADD_ENTRY_WITH_LABEL("Inactivity Timeout (s):", "Inactivity Timeout: The time (in seconds) of overall user inactivity after which the system will perform the selected action (sleep or shutdown).", inactivity_timeout_entry)
     ADD_ENTRY_WITH_LABEL("Long-Running Apps Timeout (s):", "Long-Running Applications Timeout: A separate timeout (in seconds) for when any of the specified long-running applications are active. This overrides the general inactivity timeout.", long_running_apps_timeout_entry)
     ADD_ENTRY_WITH_LABEL("Custom Long-Running Applications:", "Custom Long-Running Applications: List of processes (separated by '|') that will use the special Long-Running Applications Timeout. This can include media players, torrent clients, video editors, or any other applications that require extended periods of inactivity.", custom_long_running_apps_entry)
-    ADD_ENTRY_WITH_LABEL("Check Interval (s):", "Check Interval: The main interval (in seconds) at which the program performs its overall inactivity check. For example, if set to 3600 seconds (1 hour), the program will run a complete check every hour.", check_interval_entry)
+    ADD_ENTRY_WITH_LABEL("Check Interval (s):", "Check Interval: The fallback interval (in seconds) between inactivity checks. With XSync IDLETIME support the daemon is woken exactly when the timeout is reached, so this interval only applies while the system stays busy after the timeout or when no X server is available.", check_interval_entry)
     ADD_ENTRY_WITH_LABEL("CPU Threshold (%):", "CPU Threshold: The percentage of CPU usage above which the system is considered active.", cpu_threshold_entry)
     ADD_ENTRY_WITH_LABEL("I/O Threshold (KB/s):", "I/O Threshold: The amount of disk I/O activity (in KB/s) above which the system is considered active.", io_threshold_entry)
     ADD_ENTRY_WITH_LABEL("Network Threshold (KB/s):", "Network Threshold: The amount of network activity (in KB/s) above which the system is considered active.", net_threshold_entry)
-    ADD_ENTRY_WITH_LABEL("CPU/Net Check Interval (s):", "CPU/Net Check Interval: The interval (in seconds) between two measurements of CPU and network activity.", cpu_net_check_interval_entry)
-    ADD_ENTRY_WITH_LABEL("I/O Check Interval (s):", "I/O Check Interval: The interval (in seconds) between two I/O measurements for calculating average disk activity.\nNote: IO_CHECK_INTERVAL defines the time interval between the initial and final measurements, not the total duration of this check.", io_check_interval_entry)
+    ADD_ENTRY_WITH_LABEL("CPU Exit Threshold (%):", "CPU Exit Threshold: Once CPU usage has been considered active, it is only considered idle again below this percentage. Keep it below CPU Threshold so usage hovering around the threshold does not flap.", cpu_exit_threshold_entry)
+    ADD_ENTRY_WITH_LABEL("I/O Exit Threshold (KB/s):", "I/O Exit Threshold: Once disk I/O has been considered active, it is only considered idle again below this rate.", io_exit_threshold_entry)
+    ADD_ENTRY_WITH_LABEL("Network Exit Threshold (KB/s):", "Network Exit Threshold: Once network traffic has been considered active, it is only considered idle again below this rate.", net_exit_threshold_entry)
+    ADD_ENTRY_WITH_LABEL("Smoothing Weight (%):", "Smoothing Weight: How much each new measurement moves the smoothed CPU, I/O and network values (exponentially weighted average). 100 disables smoothing; lower values react more slowly to short bursts.", ewma_weight_entry)
+    ADD_ENTRY_WITH_LABEL("Minimum Dwell Time (s):", "Minimum Dwell Time: How long (in seconds) a signal must stay past its threshold before it switches between active and idle.", min_dwell_time_entry)
+    ADD_ENTRY_WITH_LABEL("CPU/Net Check Interval (s):", "CPU/Net Check Interval: The interval (in seconds) between two measurements of CPU and network activity.\nNote: CPU, I/O and network share one measurement window as long as the larger of the two check intervals. Only used when activity_window in config.ini is 0.", cpu_net_check_interval_entry)
+    ADD_ENTRY_WITH_LABEL("I/O Check Interval (s):", "I/O Check Interval: The interval (in seconds) between two I/O measurements for calculating average disk activity.\nNote: CPU, I/O and network share one measurement window as long as the larger of the two check intervals. Only used when activity_window in config.ini is 0.", io_check_interval_entry)
     ADD_ENTRY_WITH_LABEL("Boot Grace Period (min):", "The time (in minutes) after system boot during which the idle manager will not perform any actions. This parameter is important to prevent the system from shutting down or going to sleep immediately after boot if XorgIdleManager_Daemon is set to autostart.", boot_grace_period_entry)
 
     GtkWidget *action_label = create_label_with_tooltip("Action:", "Action to perform after inactivity (sleep or shutdown).");
@@ -1625,7 +6334,7 @@ int main(int argc, char *argv[]) {
     gtk_widget_set_halign(button_grid, GTK_ALIGN_CENTER);
     gtk_widget_set_valign(button_grid, GTK_ALIGN_END);
 
-    GtkWidget *save_button = create_button("Save and Apply", G_CALLBACK(save_and_apply));
+    save_button = create_button("Save and Apply", G_CALLBACK(save_and_apply));
     GtkWidget *generate_command_button = create_button("Generate Daemon Command", G_CALLBACK(generate_shell_command));
     GtkWidget *stop_daemon_button = create_button("Stop XorgIdleManager Daemon", G_CALLBACK(stop_daemon));
     GtkWidget *defaults_sleep_button = create_button("Restore Defaults (Sleep)", G_CALLBACK(restore_defaults_sleep));
@@ -1651,12 +6360,23 @@ int main(int argc, char *argv[]) {
     gtk_grid_attach(GTK_GRID(button_grid), cancel_button, 1, 3, 1, 1);
 
     gtk_grid_attach(GTK_GRID(grid), button_grid, 0, row, 4, 1);
+    row++;
+
+    apply_progress_label = gtk_label_new("");
+    gtk_label_set_line_wrap(GTK_LABEL(apply_progress_label), TRUE);
+    gtk_grid_attach(GTK_GRID(grid), apply_progress_label, 0, row, 4, 1);
+    bench_marks[BENCH_WIDGETS] = g_get_monotonic_time();
 
     read_config();
     get_dpms_settings();
     update_ui_values();
 
+    if (bench_startup) {
+        g_signal_connect_after(window, "draw", G_CALLBACK(on_first_frame), NULL);
+    }
     gtk_widget_show_all(window);
+    subscribe_daemon_status();
+    bench_marks[BENCH_SHOWN] = g_get_monotonic_time();
 
     gtk_main();
 